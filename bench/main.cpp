@@ -0,0 +1,498 @@
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <lppm/cli.h>
+#include <lppm/command_graph.h>
+#include <lppm/common.h>
+#include <lppm/globals.h>
+#include <lppm/handlers.h>
+#include <lppm/options.h>
+#include <lppm/os.h>
+#include <lppm/scanner.h>
+#include <lppm/substitutor.h>
+#include <lppm/template.h>
+#include <lppm/template_info.h>
+#include <lppm/utils.h>
+
+#include "synthetic_template.h"
+
+#include <signal.h>
+
+// reference implementation of the substitutor, as it was before the compiled_text engine was introduced - used as
+// a baseline for the benchmark and to verify that the new engine produces byte-identical output
+static std::string legacy_do_the_substitutions(const std::string& text, std::map<std::string, std::string>& mappings) {
+    usz current_index = 0;
+    std::string result {};
+    usz found_index = 0;
+    while ((found_index = text.find("@@", current_index)) != std::string::npos) {
+        result += text.substr(current_index, found_index - current_index);
+        current_index = found_index;
+
+        usz start_index = found_index + 2;
+        usz end_index = text.find("@@", found_index + 2);
+        if (end_index == std::string::npos)
+            break;
+
+        std::string variable_name = text.substr(start_index, end_index - start_index);
+        if (!mappings.contains(variable_name))
+            lppm::print_internal_error_and_exit(std::format("benchmark variable `{}` is not mapped", variable_name));
+
+        result += mappings.at(variable_name);
+        current_index = end_index + 2;
+    }
+
+    result += text.substr(current_index);
+    return result;
+}
+
+struct bench_settings {
+public:
+    template_shape shape {};
+    usz project_runs { 5 };
+    std::optional<std::string> json_path {};
+    // names of benchmark groups to run, all of them if empty
+    std::set<std::string> groups {};
+
+    bool should_run(const std::string& group) const { return groups.empty() || groups.contains(group); }
+};
+
+struct bench_result {
+public:
+    std::string name;
+    usz iterations { 0 };
+    double seconds { 0.0 };
+    // bytes processed by all iterations together, throughput is not reported if zero
+    u64 bytes { 0 };
+};
+
+// results of all benchmarks, printed as they come and optionally written out as JSON at the end
+class bench_report {
+public:
+    void add(bench_result result) {
+        auto line = std::format("  {}: {} iteration(s), {:.3f} ms per iteration", result.name, result.iterations,
+                                result.seconds * 1000.0 / static_cast<double>(result.iterations));
+        if (result.bytes != 0)
+            line += std::format(", {:.1f} MiB/s", mebibytes_per_second(result));
+        lppm::print_unformatted_line(line);
+        m_results.push_back(std::move(result));
+    }
+
+    std::optional<std::string> write_json(const std::string& path, const bench_settings& settings) const {
+        auto& shape = settings.shape;
+        std::string json { "{\n  \"format\": 1,\n" };
+        json += std::format("  \"jobs\": {},\n  \"marker_scanner\": \"{}\",\n", lppm::options::the().job_count(),
+                            lppm::marker_scanner_name(lppm::active_marker_scanner()));
+        json += std::format("  \"shape\": {{\"files\": {}, \"min_size\": {}, \"max_size\": {}, \"size_distribution\": "
+                            "\"{}\", \"marker_spacing\": {}, \"binary_ratio\": {}, \"directory_depth\": {}, "
+                            "\"seed\": {}}},\n",
+                            shape.file_count, shape.min_file_size, shape.max_file_size,
+                            size_distribution_name(shape.distribution), shape.marker_spacing, shape.binary_ratio,
+                            shape.directory_depth, shape.seed);
+        json += "  \"results\": [";
+        for (usz index = 0; index < m_results.size(); index++) {
+            auto& result = m_results[index];
+            json += std::format("{}\n    {{\"name\": \"{}\", \"iterations\": {}, \"seconds\": {:.9f}, \"bytes\": {}, "
+                                "\"mib_per_second\": {:.3f}}}",
+                                index == 0 ? "" : ",", result.name, result.iterations, result.seconds, result.bytes,
+                                result.bytes == 0 ? 0.0 : mebibytes_per_second(result));
+        }
+        json += "\n  ]\n}\n";
+
+        std::ofstream file { path, std::ios::binary };
+        if (!file || !(file << json) || !file.flush())
+            return std::format("cannot write file `{}`", path);
+        return {};
+    }
+
+private:
+    static double mebibytes_per_second(const bench_result& result) {
+        return static_cast<double>(result.bytes) / result.seconds / (1024.0 * 1024.0);
+    }
+
+    std::vector<bench_result> m_results {};
+};
+
+// output of the handlers is not interesting here, standard output is dropped while they run
+class silenced_output {
+public:
+    silenced_output() : m_previous(std::cout.rdbuf(m_null.rdbuf())) {}
+    ~silenced_output() { std::cout.rdbuf(m_previous); }
+
+private:
+    std::ofstream m_null { "/dev/null" };
+    std::streambuf* m_previous;
+};
+
+template <typename Function>
+static double measure_seconds(usz iterations, Function&& function) {
+    auto start = std::chrono::steady_clock::now();
+    for (usz iteration = 0; iteration < iterations; iteration++)
+        function();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static std::map<std::string, std::string> synthetic_mappings() {
+    std::map<std::string, std::string> mappings {};
+    for (auto& name : synthetic_variable_names())
+        mappings[name] = std::format("value of {} variable", name);
+    return mappings;
+}
+
+static void benchmark_substitutor(bench_report& report, usz text_size, usz marker_spacing, usz iterations) {
+    auto mappings = synthetic_mappings();
+    auto text = generate_text(text_size, marker_spacing, 0x1994);
+
+    // verify that the outputs are byte-identical before measuring anything
+    auto expected = legacy_do_the_substitutions(text, mappings);
+    auto actual = lppm::do_the_substitutions(text, mappings);
+    if (expected != actual)
+        lppm::print_fatal_and_exit("compiled_text output differs from the legacy substitutor output");
+
+    // measure legacy substitutor, full compile + render path and render-only path (compiled once)
+    usz checksum = 0;
+    lppm::print_unformatted_line(std::format("substitutor: {} bytes, marker every ~{} bytes", text.size(),
+                                             marker_spacing));
+    auto name = [&](std::string_view variant) {
+        return std::format("substitutor.{}.{}k.{}", variant, text_size / 1024, marker_spacing);
+    };
+    u64 bytes = text.size() * iterations;
+    report.add({ name("legacy"), iterations,
+                 measure_seconds(iterations, [&] { checksum += legacy_do_the_substitutions(text, mappings).size(); }),
+                 bytes });
+    report.add({ name("compile_render"), iterations,
+                 measure_seconds(iterations, [&] { checksum += lppm::do_the_substitutions(text, mappings).size(); }),
+                 bytes });
+    auto compiled = lppm::compiled_text::compile(text);
+    auto values = compiled.resolve_values(mappings);
+    report.add({ name("render"), iterations,
+                 measure_seconds(iterations, [&] { checksum += compiled.render(values).size(); }), bytes });
+    lppm::print_unformatted_line(std::format("  (checksum {})", checksum));
+}
+
+// differential test of all marker scanners supported by the CPU against std::string_view::find, on inputs dense
+// with "@" characters, so every vector lane position and tail length is exercised
+static void verify_marker_scanners() {
+    static constexpr std::string_view alphabet = "@@@@a\n";
+    std::mt19937 generator { 0x2024 };
+    std::uniform_int_distribution<usz> character_distribution { 0, alphabet.size() - 1 };
+    std::uniform_int_distribution<usz> size_distribution { 0, 300 };
+
+    usz checked = 0;
+    for (usz round = 0; round < 20000; round++) {
+        std::string text(size_distribution(generator), 'x');
+        for (auto& character : text) {
+            if (generator() % 8 == 0)
+                character = alphabet[character_distribution(generator)];
+        }
+
+        for (usz from = 0; from <= text.size() + 1; from += 1 + from / 16) {
+            usz expected = from > text.size() ? std::string_view::npos : std::string_view { text }.find("@@", from);
+            for (auto kind : lppm::supported_marker_scanners()) {
+                usz actual = lppm::find_marker_with(kind, text, from);
+                if (actual != expected) {
+                    lppm::print_fatal_and_exit(std::format(
+                        "{} marker scanner returned {} instead of {} (text size {}, starting index {})",
+                        lppm::marker_scanner_name(kind), actual, expected, text.size(), from));
+                }
+                checked++;
+            }
+        }
+    }
+    lppm::print_unformatted_line(std::format("marker scanners: {} differential checks passed", checked));
+}
+
+// checks that timed out commands are killed together with everything they started, both when they share the terminal
+// and when their output is captured - the command starts a long sleep and records its pid, which has to be gone once
+// the graph returns
+static void verify_command_termination(const std::string& workspace) {
+    std::string pid_path = std::filesystem::path { workspace } / "sleep.pid";
+    for (usz max_parallel : { 1, 2 }) {
+        std::vector<lppm::graph_command> graph {};
+        graph.push_back({ std::format("sleep 300 & echo $! > {}; wait", pid_path), {}, workspace, 1 });
+        if (max_parallel > 1)
+            graph.push_back({ "true", {}, workspace });
+        if (!lppm::run_command_graph(graph, max_parallel).has_value())
+            lppm::print_fatal_and_exit("timed out command was not reported as an error");
+
+        auto pid_text = lppm::read_all_text(pid_path);
+        i64 pid = 0;
+        if (!pid_text.has_value() ||
+            std::from_chars(pid_text->data(), pid_text->data() + pid_text->size(), pid).ec != std::errc {})
+            lppm::print_fatal_and_exit("timed out command did not record the pid of its child");
+
+        // the killed child is reaped by whoever inherited it, which may take a moment - a zombie is dead already
+        bool is_dead = false;
+        for (usz attempt = 0; attempt < 100 && !is_dead; attempt++) {
+            std::string state {};
+            std::getline(std::ifstream { std::format("/proc/{}/stat", pid) }, state);
+            is_dead = kill(static_cast<pid_t>(pid), 0) != 0 || state.find(") Z ") != std::string::npos;
+            if (!is_dead)
+                std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+        }
+        if (!is_dead) {
+            kill(static_cast<pid_t>(pid), SIGKILL);
+            lppm::print_fatal_and_exit(std::format("child {} of a timed out command is still running (max parallel {})",
+                                                   pid, max_parallel));
+        }
+    }
+    lppm::print_unformatted_line("commands: children of timed out commands are killed");
+}
+
+static void benchmark_marker_scanners(bench_report& report, usz text_size, usz iterations) {
+    // plain text with a single marker at the very end, so the whole text is scanned
+    std::string text(text_size, 'x');
+    for (usz index = 0; index < text_size; index += 61)
+        text[index] = '@';
+    text += "@@";
+
+    usz checksum = 0;
+    lppm::print_unformatted_line(std::format("marker scanners: {} bytes (active scanner: {})", text.size(),
+                                             lppm::marker_scanner_name(lppm::active_marker_scanner())));
+
+    u64 bytes = text.size() * iterations;
+    report.add({ "scanner.string_view_find", iterations,
+                 measure_seconds(iterations, [&] { checksum += std::string_view { text }.find("@@"); }), bytes });
+    for (auto kind : lppm::supported_marker_scanners()) {
+        report.add({ std::format("scanner.{}", lppm::marker_scanner_name(kind)), iterations,
+                     measure_seconds(iterations, [&] { checksum += lppm::find_marker_with(kind, text); }), bytes });
+    }
+    lppm::print_unformatted_line(std::format("  (checksum {})", checksum));
+}
+
+static void benchmark_template_info(bench_report& report, const std::string& workspace, usz command_count,
+                                    usz rule_count, usz iterations) {
+    auto text = generate_template_info(command_count, rule_count, 0x2025);
+    std::string path = std::filesystem::path { workspace } / std::format("info_{}.lppm_template", command_count);
+    std::ofstream { path, std::ios::binary } << text;
+
+    // make sure the generated info is valid before measuring anything
+    auto parsed = lppm::template_info::parse_from_file(path);
+    if (std::holds_alternative<std::string>(parsed))
+        lppm::print_fatal_and_exit(
+            std::format("generated template info is invalid - {}", std::get<std::string>(parsed)));
+
+    lppm::print_unformatted_line(std::format("template info: {} commands, {} rules, {} bytes", command_count,
+                                             rule_count, text.size()));
+    usz checksum = 0;
+    report.add({ std::format("template_info.parse_from_file.{}", command_count), iterations,
+                 measure_seconds(iterations,
+                                 [&] {
+                                     auto result = lppm::template_info::parse_from_file(path);
+                                     checksum += result.index();
+                                 }),
+                 text.size() * iterations });
+    lppm::print_unformatted_line(std::format("  (checksum {})", checksum));
+}
+
+static void benchmark_globals(bench_report& report, usz entry_count, usz iterations) {
+    // fill the globals file with the variables used by generated templates and a lot of unrelated ones
+    auto& the_globals = lppm::globals::the();
+    for (usz index = 0; index < entry_count; index++)
+        the_globals.set_value(std::format("BENCH_VARIABLE_{}", index), std::format("value number {}", index), false,
+                              index + 1 == entry_count);
+
+    lppm::print_unformatted_line(std::format("globals: {} entries", the_globals.key_set().size()));
+    report.add({ std::format("globals.load.{}", entry_count), iterations,
+                 measure_seconds(iterations, [&] { the_globals.reload(); }) });
+    // every iteration saves the file twice, once when the value is set and once when it is removed
+    report.add({ std::format("globals.save.{}", entry_count), iterations * 2, measure_seconds(iterations, [&] {
+                     the_globals.set_value("BENCH_SAVED_VARIABLE", "value", false);
+                     the_globals.remove_value("BENCH_SAVED_VARIABLE");
+                 }) });
+}
+
+static void benchmark_project_init(bench_report& report, const bench_settings& settings, const std::string& workspace) {
+    // templates are looked up by name in the config directory, which points into the workspace
+    std::string template_name = "bench";
+    std::string template_path = std::filesystem::path { lppm::os::get_lppm_config_directory() } /
+                                lppm::project_template::templates_directory_name / template_name;
+    auto generated = generate_template(template_path, settings.shape);
+    if (std::holds_alternative<std::string>(generated))
+        lppm::print_fatal_and_exit(std::get<std::string>(generated));
+    auto& shape = std::get<generated_template>(generated);
+    lppm::print_unformatted_line(
+        std::format("project init: {} files ({} binary) in {} directories, {} bytes, {} jobs", shape.file_count,
+                    shape.binary_file_count, shape.directory_count, shape.total_size,
+                    lppm::options::the().job_count()));
+
+    // the first run scans the whole template and writes its index, the following ones use the index
+    usz run_index = 0;
+    auto run_once = [&] {
+        std::string target_path = std::filesystem::path { workspace } / "projects" / std::format("run_{}", run_index++);
+        std::filesystem::create_directories(target_path);
+        silenced_output silenced {};
+        lppm::handlers::project_init_handler({ template_name, target_path });
+    };
+    report.add({ "project_init.cold", 1, measure_seconds(1, run_once), shape.total_size });
+    report.add({ "project_init.warm", settings.project_runs, measure_seconds(settings.project_runs, run_once),
+                 shape.total_size * settings.project_runs });
+
+    std::error_code code {};
+    std::filesystem::remove_all(std::filesystem::path { workspace } / "projects", code);
+}
+
+static std::optional<u64> parse_count(std::string_view text) {
+    u64 value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc {} || end != text.data() + text.size())
+        return {};
+    return value;
+}
+
+static void print_bench_usage() {
+    lppm::print_unformatted_line("usage: lppm_bench [options]");
+    lppm::print_unformatted_line("  --files <count>                     number of files in the generated template");
+    lppm::print_unformatted_line("  --min-size <size>, --max-size <size> sizes of generated files (K, M suffixes)");
+    lppm::print_unformatted_line("  --size-distribution <uniform|log-uniform>");
+    lppm::print_unformatted_line("  --marker-spacing <size>             one marker per this many bytes, 0 for none");
+    lppm::print_unformatted_line("  --binary-ratio <fraction>           fraction of binary files, between 0 and 1");
+    lppm::print_unformatted_line("  --depth <count>                     maximal directory depth of generated files");
+    lppm::print_unformatted_line("  --seed <number>                     seed of the template generator");
+    lppm::print_unformatted_line("  --runs <count>                      number of measured project init runs");
+    lppm::print_unformatted_line("  --only <group,...>                  scanner, commands, substitutor, info, globals,");
+    lppm::print_unformatted_line("                                      project");
+    lppm::print_unformatted_line("  --json <path>                       write the results into a JSON file");
+    lppm::print_unformatted_line("  (and all global lppm options, like --jobs)");
+}
+
+static std::optional<std::string> parse_bench_arguments(std::vector<std::string> arguments, bench_settings& settings) {
+    std::vector<std::string> lppm_arguments {};
+    for (usz index = 0; index < arguments.size(); index++) {
+        auto& name = arguments[index];
+        auto take_value = [&]() -> std::optional<std::string> {
+            if (index + 1 >= arguments.size())
+                return {};
+            return arguments[++index];
+        };
+        auto take_number = [&](auto parse, auto& target) -> std::optional<std::string> {
+            auto value = take_value();
+            auto parsed = value.has_value() ? parse(value.value()) : std::nullopt;
+            if (!parsed.has_value())
+                return std::format("option `{}` requires a valid value", name);
+            target = static_cast<std::remove_reference_t<decltype(target)>>(parsed.value());
+            return {};
+        };
+
+        std::optional<std::string> result {};
+        if (name == "--files") {
+            result = take_number(parse_count, settings.shape.file_count);
+        } else if (name == "--min-size") {
+            result = take_number(lppm::parse_byte_size, settings.shape.min_file_size);
+        } else if (name == "--max-size") {
+            result = take_number(lppm::parse_byte_size, settings.shape.max_file_size);
+        } else if (name == "--marker-spacing") {
+            result = take_number(lppm::parse_byte_size, settings.shape.marker_spacing);
+        } else if (name == "--depth") {
+            result = take_number(parse_count, settings.shape.directory_depth);
+        } else if (name == "--seed") {
+            result = take_number(parse_count, settings.shape.seed);
+        } else if (name == "--runs") {
+            result = take_number(parse_count, settings.project_runs);
+        } else if (name == "--size-distribution") {
+            result = take_number(parse_size_distribution, settings.shape.distribution);
+        } else if (name == "--binary-ratio") {
+            auto parse_ratio = [](const std::string& text) -> std::optional<double> {
+                char* end = nullptr;
+                double value = std::strtod(text.c_str(), &end);
+                if (text.empty() || *end != '\0' || value < 0.0 || value > 1.0)
+                    return {};
+                return value;
+            };
+            result = take_number(parse_ratio, settings.shape.binary_ratio);
+        } else if (name == "--json") {
+            settings.json_path = take_value();
+            if (!settings.json_path.has_value())
+                result = std::format("option `{}` requires a value", name);
+        } else if (name == "--only") {
+            auto value = take_value();
+            if (!value.has_value())
+                return std::format("option `{}` requires a value", name);
+            std::stringstream groups { value.value() };
+            for (std::string group {}; std::getline(groups, group, ',');)
+                settings.groups.insert(group);
+        } else if (name == "-h" || name == "--help") {
+            print_bench_usage();
+            std::exit(EXIT_SUCCESS);
+        } else {
+            // everything else is left for the global options of lppm
+            lppm_arguments.push_back(name);
+        }
+        if (result.has_value())
+            return result;
+    }
+
+    if (settings.project_runs == 0)
+        return "at least one project init run is required";
+    if (auto result = lppm::options::the().parse_arguments(lppm_arguments); result.has_value())
+        return result;
+    if (!lppm_arguments.empty())
+        return std::format("unexpected argument `{}`", lppm_arguments.front());
+    return {};
+}
+
+int main(int argc, char** argv) {
+    bench_settings settings {};
+    if (auto result = parse_bench_arguments({ argv + 1, argv + argc }, settings); result.has_value()) {
+        print_bench_usage();
+        lppm::print_fatal_and_exit(result.value());
+    }
+
+    // everything is done inside of a fresh workspace, which also serves as the lppm config directory - the globals
+    // file is written before globals are used for the first time, so no warnings about it are printed
+    std::string workspace = std::filesystem::temp_directory_path() / std::format("lppm_bench_{:08x}",
+                                                                                 std::random_device {}());
+    setenv("XDG_CONFIG_HOME", workspace.c_str(), 1);
+    lppm::os::ensure_directory_exists(lppm::os::get_lppm_config_directory());
+    {
+        std::ofstream globals_file { std::filesystem::path { lppm::os::get_lppm_config_directory() } / "globals.conf" };
+        for (auto& [name, value] : synthetic_mappings())
+            globals_file << std::format("{}:{}\n", name, value);
+    }
+
+    bench_report report {};
+    if (settings.should_run("scanner")) {
+        verify_marker_scanners();
+        benchmark_marker_scanners(report, 16 * 1024 * 1024, 20);
+    }
+    if (settings.should_run("commands"))
+        verify_command_termination(workspace);
+    if (settings.should_run("substitutor")) {
+        benchmark_substitutor(report, 4 * 1024 * 1024, 64, 20);
+        benchmark_substitutor(report, 4 * 1024 * 1024, 4096, 20);
+        benchmark_substitutor(report, 32 * 1024 * 1024, 1024, 5);
+    }
+    if (settings.should_run("info")) {
+        benchmark_template_info(report, workspace, 10, 10, 2000);
+        benchmark_template_info(report, workspace, 1000, 200, 50);
+    }
+    if (settings.should_run("globals"))
+        benchmark_globals(report, 1000, 50);
+    if (settings.should_run("project"))
+        benchmark_project_init(report, settings, workspace);
+
+    std::error_code code {};
+    std::filesystem::remove_all(workspace, code);
+    if (settings.json_path.has_value()) {
+        if (auto result = report.write_json(settings.json_path.value(), settings); result.has_value())
+            lppm::print_fatal_and_exit(result.value());
+        lppm::print_info(std::format("results written to `{}`", settings.json_path.value()));
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+#include "synthetic_template.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <variant>
+
+#include <lppm/template.h>
+
+static constexpr usz directory_fanout = 4;
+
+std::optional<size_distribution> parse_size_distribution(std::string_view name) {
+    if (name == "uniform")
+        return size_distribution::uniform;
+    if (name == "log-uniform")
+        return size_distribution::log_uniform;
+    return {};
+}
+
+std::string_view size_distribution_name(size_distribution distribution) {
+    switch (distribution) {
+        case size_distribution::uniform:
+            return "uniform";
+        case size_distribution::log_uniform:
+            return "log-uniform";
+    }
+    return "unknown";
+}
+
+const std::vector<std::string>& synthetic_variable_names() {
+    static const std::vector<std::string> result { "NAME", "AUTHOR", "EMAIL", "PROJECT_NAME", "LICENSE", "WEBSITE" };
+    return result;
+}
+
+std::string generate_text(usz size, usz marker_spacing, u32 seed) {
+    static constexpr std::string_view alphabet = "abcdefghijklmnopqrstuvwxyz0123456789 {}();=+-*/<>\t\n";
+    auto& variable_names = synthetic_variable_names();
+    std::mt19937 generator { seed };
+    std::uniform_int_distribution<usz> character_distribution { 0, alphabet.size() - 1 };
+    std::uniform_int_distribution<usz> spacing_distribution { marker_spacing / 2, marker_spacing + marker_spacing / 2 };
+    std::uniform_int_distribution<usz> variable_distribution { 0, variable_names.size() - 1 };
+
+    std::string result {};
+    result.reserve(size + 64);
+    usz next_marker = marker_spacing == 0 ? static_cast<usz>(-1) : spacing_distribution(generator);
+    while (result.size() < size) {
+        if (result.size() >= next_marker) {
+            result += "@@";
+            result += variable_names[variable_distribution(generator)];
+            result += "@@";
+            next_marker = result.size() + spacing_distribution(generator);
+            continue;
+        }
+        result += alphabet[character_distribution(generator)];
+    }
+
+    // make sure unterminated markers at the end of the text are handled the same way too
+    if (marker_spacing != 0)
+        result += "trailing @@UNTERMINATED";
+    return result;
+}
+
+std::string generate_template_info(usz command_count, usz rule_count, u32 seed) {
+    static constexpr std::string_view actions[] = { "render", "copy", "skip", "executable" };
+    std::mt19937 generator { seed };
+
+    std::string result { "LPPM TEMPLATE V2\ntimeout 10m\n\n[rules]\n" };
+    for (usz rule = 0; rule < rule_count; rule++)
+        result += std::format("{} d{}/**/*.{}\n", actions[generator() % std::size(actions)], rule % directory_fanout,
+                              rule);
+    for (usz command = 0; command < command_count; command++) {
+        result += std::format("\n[command]\n# command number {}\n", command);
+        if (command % 4 == 3) {
+            result += "run <<END\necho @@PROJECT_NAME@@\necho done\nEND\n";
+        } else {
+            result += std::format("run echo @@NAME@@ {} > out_{}.txt\n", command, command);
+        }
+        if (command > 0)
+            result += std::format("after {}\n", generator() % command);
+        result += "timeout 30s\nmemory 512M\n";
+    }
+    return result;
+}
+
+std::variant<std::string, generated_template> generate_template(const std::string& directory,
+                                                                const template_shape& shape) {
+    std::mt19937 generator { shape.seed };
+    std::uniform_real_distribution<double> unit_distribution { 0.0, 1.0 };
+    auto random_size = [&]() -> usz {
+        auto minimum = static_cast<double>(std::max<usz>(shape.min_file_size, 1));
+        auto maximum = static_cast<double>(std::max(shape.max_file_size, shape.min_file_size));
+        double value = shape.distribution == size_distribution::uniform
+                           ? minimum + (maximum - minimum) * unit_distribution(generator)
+                           : std::exp(std::log(minimum) + (std::log(maximum) - std::log(minimum)) *
+                                                              unit_distribution(generator));
+        return static_cast<usz>(value);
+    };
+
+    std::error_code code {};
+    std::filesystem::create_directories(directory, code);
+    if (code)
+        return std::format("cannot create directory `{}` - {}", directory, code.message());
+
+    generated_template result {};
+    std::ofstream info_file { std::filesystem::path { directory } / lppm::project_template::template_info_file_name };
+    info_file << "LPPM TEMPLATE V2\n";
+    if (!info_file.flush())
+        return std::format("cannot write template info into `{}`", directory);
+
+    for (usz index = 0; index < shape.file_count; index++) {
+        // pick a directory - one of the top level directories has a variable in its name
+        std::filesystem::path relative_path {};
+        usz depth = shape.directory_depth == 0 ? 0 : generator() % (shape.directory_depth + 1);
+        for (usz level = 0; level < depth; level++) {
+            usz branch = generator() % directory_fanout;
+            relative_path /= branch == 0 && level == 0 ? std::string { "@@PROJECT_NAME@@_dir" }
+                                                       : std::format("d{}", branch);
+        }
+        auto file_directory = std::filesystem::path { directory } / relative_path;
+        std::filesystem::create_directories(file_directory, code);
+        if (code)
+            return std::format("cannot create directory `{}` - {}", static_cast<std::string>(file_directory),
+                               code.message());
+
+        // write the file itself
+        usz size = random_size();
+        bool is_binary = unit_distribution(generator) < shape.binary_ratio;
+        std::string contents {};
+        if (is_binary) {
+            contents.resize(size);
+            for (auto& character : contents)
+                character = static_cast<c8>(generator() & 0xff);
+            contents[0] = '\0';
+        } else {
+            contents = generate_text(size, shape.marker_spacing, static_cast<u32>(generator()));
+        }
+        auto name = index % 16 == 0 ? std::format("@@NAME@@_{}.txt", index)
+                                    : std::format("file_{}.{}", index, is_binary ? "bin" : "txt");
+        auto path = file_directory / name;
+        std::ofstream file { path, std::ios::binary };
+        if (!file || !file.write(contents.data(), static_cast<std::streamsize>(contents.size())) || !file.flush())
+            return std::format("cannot write file `{}`", static_cast<std::string>(path));
+
+        result.file_count++;
+        result.binary_file_count += is_binary ? 1 : 0;
+        result.total_size += contents.size();
+    }
+
+    for (std::filesystem::recursive_directory_iterator iterator { directory, code }, end {};
+         !code && iterator != end; iterator.increment(code)) {
+        if (iterator->is_directory(code))
+            result.directory_count++;
+    }
+    return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+
+// how sizes of generated files are spread between the minimal and the maximal size - log-uniform gives many small
+// files and a few big ones, like in real projects
+enum class size_distribution {
+    uniform,
+    log_uniform,
+};
+
+// shape of a generated template
+struct template_shape {
+public:
+    usz file_count { 500 };
+    usz min_file_size { 128 };
+    usz max_file_size { 256 * 1024 };
+    size_distribution distribution { size_distribution::log_uniform };
+    // roughly one marker per this many bytes of text files, no markers at all if zero
+    usz marker_spacing { 512 };
+    // fraction of files filled with random bytes instead of text
+    double binary_ratio { 0.1 };
+    // files are placed at most this many directories deep
+    usz directory_depth { 3 };
+    u32 seed { 0x1994 };
+};
+
+struct generated_template {
+public:
+    usz file_count { 0 };
+    usz binary_file_count { 0 };
+    usz directory_count { 0 };
+    u64 total_size { 0 };
+};
+
+std::optional<size_distribution> parse_size_distribution(std::string_view name);
+std::string_view size_distribution_name(size_distribution distribution);
+
+// names of all variables used by generated texts and templates
+const std::vector<std::string>& synthetic_variable_names();
+
+// generates a pseudo-random text of given size with roughly one marker per marker_spacing bytes (none if it is zero)
+std::string generate_text(usz size, usz marker_spacing, u32 seed);
+// generates the text of a version 2 template info file with given number of commands and path rules
+std::string generate_template_info(usz command_count, usz rule_count, u32 seed);
+// writes a template with given shape into the directory, which should not exist yet - some of the directory and file
+// names contain markers as well
+std::variant<std::string, generated_template> generate_template(const std::string& directory,
+                                                                const template_shape& shape);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// content-addressed store of template files, shared by all templates - every distinct file contents is stored once as
+// a read-only blob named after its SHA-256 hash (with "-x" appended for executable files), and template files are
+// hard links to these blobs, so the link count of a blob tells how many template files still use it and a blob with
+// no other links can be removed - each template directory lists the blobs it links to in its manifest file
+class blob_store {
+public:
+    static inline std::string manifest_file_name = ".lppm_manifest";
+    static inline std::string store_directory_name = "store";
+
+    struct manifest_entry {
+    public:
+        std::string blob_name;
+        u64 size { 0 };
+        std::string relative_path;
+    };
+
+    struct collection_result {
+    public:
+        usz removed_blobs { 0 };
+        u64 removed_bytes { 0 };
+    };
+
+    static std::string blobs_directory();
+
+    // stores the contents of the source file (unless a blob with the same contents exists already) and links the
+    // target path to its blob, falling back to a plain copy if the store is on a different filesystem
+    static std::variant<std::string, manifest_entry> add_file(const std::string& source_path,
+                                                              const std::string& target_path,
+                                                              const std::string& relative_path);
+
+    static std::optional<std::string> write_manifest(const std::string& template_directory,
+                                                     const std::vector<manifest_entry>& entries);
+    static std::vector<manifest_entry> read_manifest(const std::string& template_directory);
+
+    // removes the template directory and then the blobs which were used only by it
+    static std::optional<std::string> remove_template_directory(const std::string& template_directory);
+    // removes the given blobs if nothing links to them anymore
+    static collection_result release(const std::vector<manifest_entry>& entries);
+    // goes through the whole store and removes all blobs nothing links to (and leftover temporary files)
+    static std::variant<std::string, collection_result> collect_garbage();
+
+private:
+    static std::string blob_path(const std::string& blob_name);
+};
+
+} // namespace lppm
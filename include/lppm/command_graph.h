@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/os.h>
+
+namespace lppm {
+
+struct graph_command {
+public:
+    std::string command;
+    // indices of the commands that have to succeed before this one is started, all lower than its own index
+    std::vector<usz> dependencies;
+    std::string working_directory;
+    std::optional<u64> timeout_seconds {};
+    resource_limits limits {};
+};
+
+// terminated commands (and everything they started) are killed if they are still running after this period
+static constexpr std::chrono::seconds termination_grace_period { 5 };
+
+// runs the commands in their working directories as soon as their dependencies succeed, at most max_parallel at once -
+// the output of every command is printed line by line, prefixed with the command index, followed by its running time
+// and the way it finished - the first failing (or timed out) command stops the whole graph, so no new commands are
+// started and the running ones are terminated (with SIGTERM, then with SIGKILL after the grace period)
+// if the commands can only run one at a time (every one of them depends on the previous one, or max_parallel is one),
+// they share the terminal with lppm instead, so they may read from it, and only their running time is printed
+std::optional<std::string> run_command_graph(const std::vector<graph_command>& commands, usz max_parallel,
+                                             std::optional<u64> timeout_seconds = {});
+
+} // namespace lppm
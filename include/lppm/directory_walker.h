@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// walks a directory tree in pre-order (in the order the system lists entries, like recursive_directory_iterator),
+// keeping a descriptor of every directory on the way down - entries are read with getdents64 and classified by their
+// d_type, so only entries of unknown type and symbolic links are stat-ed, while directories are opened relative to
+// their parents instead of resolving their whole paths again
+// symbolic links to directories are reported as directories, but they are never entered
+// NOTE: without descriptor support, the tree is walked with directory_iterator and whole paths are used instead
+class directory_walker {
+public:
+    static constexpr usz read_buffer_size = 64 * 1024;
+
+    struct entry {
+    public:
+        // whole path of the entry (the root path followed by the path relative to it) and the positions where the
+        // relative path and the name of the entry start
+        std::string_view path;
+        usz relative_offset;
+        usz name_offset;
+        // descriptor of the directory containing the entry (or -1), valid only while the entry is visited
+        int directory_fd;
+        bool is_directory;
+        bool is_symbolic_link;
+
+        std::string_view relative_path() const { return path.substr(relative_offset); }
+        std::string_view name() const { return path.substr(name_offset); }
+    };
+
+    struct file_stamp {
+    public:
+        u64 size;
+        // in the units of std::filesystem::last_write_time
+        i64 modification_time;
+    };
+
+    enum class action {
+        proceed,
+        // only meaningful for directories, which are not entered then
+        skip,
+        stop,
+    };
+
+    using visitor = std::function<action(const entry& visited)>;
+
+    // returns an error if any directory could not be read, stopping the walk is not an error
+    static std::optional<std::string> walk(const std::string& root_path, const visitor& visit);
+    // size and modification time of a visited file (following symbolic links), read relative to its directory
+    static std::optional<file_stamp> stamp_of(const entry& visited);
+
+private:
+    directory_walker(const std::string& root_path, const visitor& visit);
+
+    std::optional<std::string> walk_directory(int directory_fd);
+
+    const visitor& m_visit;
+    // path of the currently visited entry, only its end changes during the walk
+    std::string m_path {};
+    usz m_relative_offset { 0 };
+    std::vector<u64> m_buffer {};
+    bool m_stopped { false };
+};
+
+} // namespace lppm
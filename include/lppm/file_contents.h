@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/os.h>
+
+namespace lppm {
+
+// read-only contents of a file - large files (and all non-empty files, if always_map is set) are memory-mapped, small
+// ones are read with a single pread into a buffer taken from a shared pool (and returned to it on destruction), in
+// both cases the contents can be consumed through view() without any further copies
+class file_contents {
+public:
+    static constexpr usz mapping_threshold = 128 * 1024;
+
+    static std::variant<std::string, file_contents> read(const std::string& path, bool always_map = false);
+    // the file is opened relative to the directory of the location, if there is a descriptor of it
+    static std::variant<std::string, file_contents> read(const entry_location& location, bool always_map = false);
+
+    file_contents(file_contents&& other) noexcept;
+    file_contents& operator=(file_contents&& other) noexcept;
+    file_contents(const file_contents&) = delete;
+    file_contents& operator=(const file_contents&) = delete;
+    ~file_contents();
+
+    std::string_view view() const;
+    usz size() const;
+    bool is_mapped() const;
+
+private:
+    file_contents() = default;
+
+    void release();
+
+    void* m_mapping { nullptr };
+    usz m_mapping_size { 0 };
+    std::vector<c8> m_buffer {};
+};
+
+} // namespace lppm
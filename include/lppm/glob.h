@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string_view>
+
+namespace lppm {
+
+// matches a path (with components separated by "/") against a glob pattern:
+// - "*" matches any sequence of characters within a single path component,
+// - "?" matches any single character except "/",
+// - "[abc]", "[a-z]" and "[!abc]" match a single character from (or not from) the given set,
+// - "**" as a whole component matches any number of components (including none),
+// - "\" makes the next character match literally
+bool match_glob(std::string_view pattern, std::string_view path);
+
+} // namespace lppm
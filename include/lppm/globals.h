@@ -3,35 +3,72 @@
 #include <map>
 #include <optional>
 #include <string>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#include <lppm/common.h>
+
 namespace lppm {
 
+// global replacement variables are stored in globals.conf, with changes appended to globals.journal instead of
+// rewriting the whole file - the journal is replayed on load and compacted back into globals.conf (through a temporary
+// file and a rename) once it grows larger than the set of values itself, so every change costs O(1) amortized
 class globals {
 public:
+    using entry = std::pair<std::string, std::string>;
+
     static globals& the();
 
     std::map<std::string, std::string> mappings() const;
+    // the values themselves, without a copy - the reference stays valid, while the contents change with them
+    const std::map<std::string, std::string>& values() const;
     std::vector<std::string> key_set() const;
     bool contains_key(const std::string& key) const;
     std::optional<std::string> get_value(const std::string& key) const;
     void set_value(const std::string& key, const std::string& value, bool should_fail_on_override,
                    bool should_save_file = true);
     void remove_value(const std::string& key, bool should_save_file = true);
+    // sets all values at once, overriding existing ones without asking - they are saved in a single batch
+    void import_values(const std::vector<entry>& entries);
+    // reads the globals file again, dropping all values that were not saved
+    void reload();
+
+    // changes made between begin_batch and commit_batch are appended to the journal at once, when the batch is
+    // committed - batches may be nested, only the outermost commit saves the changes
+    void begin_batch();
+    void commit_batch();
+
+    // reads entries in the <key>:<value> form, skipping empty lines and comments - used for files given by the user,
+    // so malformed lines and duplicated keys are errors
+    static std::variant<std::string, std::vector<entry>> read_entries_file(const std::string& path);
 
 private:
     static constexpr std::string globals_file_name = "globals.conf";
+    static constexpr std::string journal_file_name = "globals.journal";
+    // the journal is compacted once it has more records than this or than there are values, whichever is more
+    static constexpr usz min_compaction_threshold = 64;
 
     globals();
 
-    void save_globals_file() const;
+    void load_globals_file();
+    void load_journal_file();
+    void confirm_saving_malformed_file() const;
+    void save_changes();
+    void save_globals_file();
 
     static std::string get_globals_file_path();
+    static std::string get_journal_file_path();
 
     static inline globals* s_the { nullptr };
 
     std::map<std::string, std::string> m_values {};
     mutable bool m_was_file_malformed_on_read { false };
+
+    // journal records not written yet and the number of records already in the journal file
+    std::vector<std::string> m_pending_records {};
+    usz m_journal_record_count { 0 };
+    usz m_batch_depth { 0 };
 };
 
 } // namespace lppm
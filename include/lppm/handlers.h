@@ -8,17 +8,31 @@ namespace lppm::handlers {
 bool globals_get_handler(const std::vector<std::string>& arguments);
 bool globals_set_handler(const std::vector<std::string>& arguments);
 bool globals_unset_handler(const std::vector<std::string>& arguments);
+bool globals_import_handler(const std::vector<std::string>& arguments);
 bool globals_list_handler(const std::vector<std::string>& arguments);
 bool globals_init_handler(const std::vector<std::string>& arguments);
 bool project_create_handler(const std::vector<std::string>& arguments);
 bool project_init_handler(const std::vector<std::string>& arguments);
+bool project_create_many_handler(const std::vector<std::string>& arguments);
 bool template_import_handler(const std::vector<std::string>& arguments);
 bool template_create_handler(const std::vector<std::string>& arguments);
 bool template_list_handler(const std::vector<std::string>& arguments);
 bool template_show_handler(const std::vector<std::string>& arguments);
 bool template_remove_handler(const std::vector<std::string>& arguments);
+bool template_pack_handler(const std::vector<std::string>& arguments);
+bool template_unpack_handler(const std::vector<std::string>& arguments);
+bool template_gc_handler(const std::vector<std::string>& arguments);
+bool template_timeout_handler(const std::vector<std::string>& arguments);
 bool template_cmd_add_handler(const std::vector<std::string>& arguments);
 bool template_cmd_remove_handler(const std::vector<std::string>& arguments);
+bool template_cmd_after_handler(const std::vector<std::string>& arguments);
+bool template_cmd_limit_handler(const std::vector<std::string>& arguments);
+bool template_cmd_directory_handler(const std::vector<std::string>& arguments);
 bool template_cmd_list_handler(const std::vector<std::string>& arguments);
+bool template_rule_add_handler(const std::vector<std::string>& arguments);
+bool template_rule_remove_handler(const std::vector<std::string>& arguments);
+bool template_rule_list_handler(const std::vector<std::string>& arguments);
+bool template_default_set_handler(const std::vector<std::string>& arguments);
+bool template_default_list_handler(const std::vector<std::string>& arguments);
 
 } // namespace lppm::handlers
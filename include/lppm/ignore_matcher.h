@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// decides which entries of a template (or of a template source) are left out, using patterns from the .lppmignore file
+// in its root directory - the patterns follow gitignore semantics:
+// - empty lines and lines starting with "#" are ignored, "!" negates a pattern and the last matching pattern wins,
+// - a trailing "/" makes a pattern match directories only,
+// - patterns containing "/" (other than a trailing one) are matched against the whole path relative to the root, the
+//   other ones against the entry name at any depth
+// walks are expected to prune ignored directories, so only the entry itself (and not its parents) is checked
+class ignore_matcher {
+public:
+    static inline std::string ignore_file_name = ".lppmignore";
+
+    // a missing ignore file means nothing is ignored
+    static ignore_matcher load(const std::string& directory);
+    static ignore_matcher parse(std::string_view contents);
+
+    bool is_ignored(std::string_view relative_path, bool is_directory) const;
+    bool empty() const;
+
+private:
+    enum class pattern_kind {
+        literal,
+        suffix,
+        glob,
+    };
+
+    struct pattern {
+    public:
+        pattern_kind kind;
+        std::string text;
+        bool negated { false };
+        bool directories_only { false };
+        bool anchored { false };
+    };
+
+    bool matches(const pattern& pattern, std::string_view relative_path, std::string_view name,
+                 bool is_directory) const;
+
+    std::vector<pattern> m_patterns {};
+    // indices of the unanchored literal patterns (the most common ones, like "node_modules/") by the name they match,
+    // so they are found with a single lookup instead of being checked one by one
+    std::unordered_map<std::string, std::vector<usz>> m_literal_names {};
+    std::vector<usz> m_other_patterns {};
+};
+
+} // namespace lppm
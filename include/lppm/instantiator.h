@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/file_contents.h>
+#include <lppm/ignore_matcher.h>
+#include <lppm/io_uring_writer.h>
+#include <lppm/os.h>
+#include <lppm/substitutor.h>
+#include <lppm/template.h>
+#include <lppm/template_index.h>
+#include <lppm/template_pack.h>
+#include <lppm/template_info.h>
+#include <lppm/thread_pool.h>
+#include <lppm/variable_scope.h>
+
+namespace lppm {
+
+// creates a project from a template in three stages:
+// - discovery: the template directory is walked and all file names, file contents and template commands are scanned
+//   for variables (file contents are taken from the template index or scanned by a pool of worker threads, which
+//   start with the first files found, while the walk goes on),
+// - resolution: values of all variables missing from the variable scope are asked for at once, before anything is
+//   written (in non-interactive mode, all of them are reported as a single error instead) - every discovered
+//   variable gets an integer id, and the values of all of them are looked up once per target into a table indexed
+//   by these ids,
+// - rendering: directories are created in the walk order (before any file inside of them), while files are rendered
+//   and written by the worker threads - this stage is non-interactive, it only reads values from the tables, while
+//   created directories are kept open (up to a budget of descriptors), so entries are created relative to them
+// packed templates are instantiated the same way, with the entries and descriptions of their contents taken from the
+// pack instead of the template directory and the index
+// small rendered files may be written in batches through io_uring, every worker has its own ring and batch
+// entries ignored by the .lppmignore file of the template are left out (ignored directories are not even entered),
+// while path rules of the template decide which entries are skipped, which files are copied or rendered regardless
+// of their contents and which of them are made executable
+// many projects can be created from the template at once - discovery is done only once for all of them, while every
+// rendered file is read and compiled once and then rendered into all targets concurrently, each with its own scope
+class project_instantiator {
+public:
+    // contents of files read during discovery are kept for rendering, as long as their total size is below this
+    static constexpr usz discovery_cache_budget = 64 * 1024 * 1024;
+    // at most this many directories of all targets are kept open during rendering, entries of the remaining ones are
+    // created through their whole paths - the same number of template directories is kept open for reading
+    static constexpr usz directory_descriptor_budget = 256;
+
+    struct target {
+    public:
+        std::string path;
+        variable_scope* scope;
+    };
+
+    project_instantiator(const project_template& the_template, std::string target_path, variable_scope& scope);
+    project_instantiator(const project_template& the_template, std::vector<target> targets);
+
+    project_instantiator(const project_instantiator&) = delete;
+    project_instantiator& operator=(const project_instantiator&) = delete;
+    ~project_instantiator();
+
+    std::optional<std::string> instantiate(usz worker_count);
+
+private:
+    enum class file_kind {
+        directory,
+        copied,
+        rendered,
+        streamed,
+    };
+
+    static constexpr usz no_parent = static_cast<usz>(-1);
+
+    struct template_entry {
+    public:
+        std::string source_path;
+        std::string relative_path;
+        file_kind kind;
+        path_actions actions {};
+        u64 size { 0 };
+        i64 modification_time { 0 };
+        std::vector<std::string> variables {};
+        std::vector<compiled_text::segment> markers {};
+        std::optional<file_contents> cached_contents {};
+        // contents of files from packed templates, inside of the mapped pack
+        std::optional<std::string_view> packed_contents {};
+        // entries form a tree mirroring the template directory - the parent is the index of the directory entry
+        // containing this one and the name is the last component of the relative path, compiled once
+        usz parent { no_parent };
+        std::optional<compiled_text> name {};
+        // paths (and descriptors, if they are kept open) of directories in all targets, rendered once and reused by
+        // all entries inside of them
+        std::vector<std::string> target_paths {};
+        std::vector<int> target_fds {};
+        // the entry is read relative to the template directory containing it, if its descriptor is kept open - the
+        // name of the entry starts at the given position of the source path, and directories keep their own
+        // descriptor for the entries inside of them
+        int source_parent_fd { entry_location::no_descriptor };
+        usz source_name_offset { 0 };
+        int source_fd { entry_location::no_descriptor };
+        bool is_symbolic_link { false };
+    };
+
+    // contents of a rendered file, shared by the rendering tasks of all targets
+    struct rendered_source {
+    public:
+        std::optional<file_contents> contents {};
+        std::optional<compiled_text> compiled {};
+        // ids of the variables of the compiled text, in the order of its variables
+        std::vector<usz> variable_ids {};
+        // only counted when profiling
+        usz marker_count { 0 };
+    };
+
+    struct write_batch {
+    public:
+        std::unique_ptr<io_uring_writer> writer {};
+        std::vector<io_uring_writer::pending_write> files {};
+    };
+
+    std::optional<std::string> discover(thread_pool& pool);
+    std::optional<std::string> collect_entries(thread_pool& pool);
+    std::optional<std::string> collect_packed_entries(const template_pack& pack);
+    void schedule_discovery(thread_pool& pool, template_entry& entry);
+    void link_entries();
+    std::optional<std::string> discover_file(template_entry& entry);
+    void apply_index_entry(template_entry& entry, const template_index::file_entry& index_entry);
+    void save_index();
+    std::optional<std::string> resolve_missing_variables();
+    void fill_value_tables();
+    usz id_of_variable(const std::string& name) const;
+    std::optional<std::string> render(thread_pool& pool);
+    void create_directories(template_entry& entry, const std::vector<entry_location>& target_locations);
+    void render_to_targets(template_entry& entry, std::vector<entry_location> target_locations);
+    std::variant<std::string, std::shared_ptr<const rendered_source>> prepare_source(template_entry& entry);
+    void render_to_target(const template_entry& entry, usz target_index, const entry_location& target_location,
+                          const rendered_source* source);
+    std::optional<std::string> render_file(const template_entry& entry, usz target_index,
+                                           const entry_location& target_location, const rendered_source* source);
+    void create_write_batches(usz worker_count);
+    void flush_write_batch(write_batch& batch);
+    void report_write_batches() const;
+    std::optional<std::string> write_file(const entry_location& target_location, std::string_view contents);
+    void close_target_directories();
+    void close_source_directories();
+    entry_location source_location_of(const template_entry& entry) const;
+
+    // creates the parent directories introduced by separators in the rendered name of a file, if there are any
+    std::vector<entry_location> target_locations_of(const template_entry& entry);
+    void record_error(std::string error);
+
+    const project_template& m_template;
+    std::vector<target> m_targets {};
+    // one resolver for every target, reading its value table
+    std::vector<variable_resolver> m_resolvers {};
+    // values of all discovered variables for every target, indexed by variable ids
+    std::vector<std::vector<const std::string*>> m_value_tables {};
+    ignore_matcher m_ignore;
+
+    template_index m_index;
+    std::mutex m_index_mutex {};
+
+    // references to entries stay valid while more of them are added, so they can be scanned during the walk
+    std::deque<template_entry> m_entries {};
+    // discovered variables in order of first appearance, the position of a variable is its id
+    std::vector<std::string> m_discovered_variables {};
+    std::unordered_map<std::string, usz> m_variable_ids {};
+    std::atomic<usz> m_cached_size { 0 };
+    // descriptor of the template directory itself and the number of template directory descriptors kept open
+    int m_source_root_fd { entry_location::no_descriptor };
+    usz m_open_source_directory_count { 0 };
+
+    thread_pool* m_render_pool { nullptr };
+    // descriptors of the target directories themselves and the number of directory descriptors kept open
+    std::vector<int> m_target_fds {};
+    usz m_open_directory_count { 0 };
+    std::vector<write_batch> m_write_batches {};
+
+    std::mutex m_error_mutex {};
+    std::optional<std::string> m_error {};
+    std::atomic<bool> m_failed { false };
+};
+
+} // namespace lppm
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/os.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace lppm {
+
+// writes batches of small files through io_uring - all files of a batch are opened with a single submission, then
+// written and closed with another one, instead of doing three blocking system calls per file
+// NOTE: a writer must not be used by more than one thread at a time
+class io_uring_writer {
+public:
+    static constexpr unsigned ring_entries = 256;
+    static constexpr usz max_batch_size = ring_entries / 2;
+    static constexpr usz max_file_size = 256 * 1024;
+
+    struct pending_write {
+    public:
+        entry_location location;
+        std::string contents;
+    };
+
+    struct statistics {
+    public:
+        usz files_written { 0 };
+        usz batches { 0 };
+        usz submissions { 0 };
+        u64 batch_nanoseconds { 0 };
+    };
+
+    // returns nullptr if io_uring (or any of the operations needed) is not supported by the kernel or is not allowed
+    static std::unique_ptr<io_uring_writer> create();
+
+    io_uring_writer(const io_uring_writer&) = delete;
+    io_uring_writer& operator=(const io_uring_writer&) = delete;
+    ~io_uring_writer();
+
+    struct write_result {
+    public:
+        // files that were not written, these should be written again through the regular path, which reports proper
+        // errors - it is safe to do so right away, nothing from the batch is in flight anymore
+        std::vector<usz> failed_files {};
+        // files whose writes may still be in flight, because the ring failed and could not be waited on - these must
+        // not be written again and should be reported as errors (their contents are taken over by the writer)
+        std::vector<usz> lost_files {};
+    };
+
+    // writes all given files (at most max_batch_size of them) - once a submission fails, the ring is released and the
+    // writer is not usable anymore, all files given to it are then reported as failed
+    write_result write_files(std::vector<pending_write>& files);
+
+    bool is_usable() const;
+    const statistics& stats() const;
+
+private:
+    io_uring_writer() = default;
+
+    io_uring_sqe* next_sqe();
+    bool submit_and_wait(unsigned submitted, unsigned wait_for);
+    template <typename Callback>
+    void reap_completions(Callback&& callback);
+    template <typename Callback>
+    bool abandon(std::vector<pending_write>& files, usz count, Callback&& callback);
+    void release_ring();
+
+    int m_ring_fd { -1 };
+    void* m_sq_ring { nullptr };
+    usz m_sq_ring_size { 0 };
+    void* m_cq_ring { nullptr };
+    usz m_cq_ring_size { 0 };
+    io_uring_sqe* m_sqes { nullptr };
+    usz m_sqes_size { 0 };
+
+    unsigned* m_sq_head { nullptr };
+    unsigned* m_sq_tail { nullptr };
+    unsigned* m_sq_mask { nullptr };
+    unsigned* m_sq_array { nullptr };
+    unsigned* m_cq_head { nullptr };
+    unsigned* m_cq_tail { nullptr };
+    unsigned* m_cq_mask { nullptr };
+    io_uring_cqe* m_cqes { nullptr };
+
+    // entries consumed by the kernel whose completions were not reaped yet
+    unsigned m_in_flight { 0 };
+    bool m_is_usable { true };
+    std::vector<std::string> m_lost_contents {};
+
+    statistics m_stats {};
+};
+
+} // namespace lppm
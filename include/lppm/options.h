@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+struct option_description {
+public:
+    std::string usage;
+    std::string description;
+};
+
+// backend used to write rendered files
+enum class io_backend_kind {
+    automatic,
+    io_uring,
+    synchronous,
+};
+
+// how questions which would be asked on the standard input are handled
+enum class prompt_policy {
+    // ask the user
+    interactive,
+    // never ask - missing variable values and confirmations are errors
+    non_interactive,
+    // never ask - confirmations are answered with yes, missing variable values are still errors
+    assume_yes,
+};
+
+// global command line options, accepted only before the operation name (and before "--")
+class options {
+public:
+    static options& the();
+    static const std::vector<option_description>& descriptions();
+
+    std::optional<std::string> parse_arguments(std::vector<std::string>& arguments);
+
+    usz job_count() const;
+    io_backend_kind io_backend() const;
+    bool should_print_stats() const;
+    const std::optional<std::string>& trace_path() const;
+    prompt_policy prompts() const;
+    // values of variables given with -D and --vars-file, they override values from all other sources
+    const std::map<std::string, std::string>& variables() const;
+
+private:
+    options() = default;
+
+    static inline options* s_the { nullptr };
+
+    usz m_job_count { 0 };
+    io_backend_kind m_io_backend { io_backend_kind::automatic };
+    bool m_should_print_stats { false };
+    std::optional<std::string> m_trace_path {};
+    prompt_policy m_prompts { prompt_policy::interactive };
+    std::map<std::string, std::string> m_variables {};
+};
+
+} // namespace lppm
@@ -1,16 +1,125 @@
 #pragma once
+#include <chrono>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <variant>
+
+#include <lppm/common.h>
 
 namespace lppm {
 
+// how standard streams of a command are set up (either way, the command runs in its own process group):
+// - inherited: the command shares the terminal with lppm, like with std::system - its process group is the foreground
+//   one while it runs,
+// - captured: the command has no standard input and its standard output and error are redirected into a single pipe
+enum class command_output {
+    inherited,
+    captured,
+};
+
+// resource limits applied to a started command (and inherited by everything it starts)
+struct resource_limits {
+public:
+    std::optional<u64> cpu_seconds {};
+    std::optional<u64> memory_bytes {};
+};
+
+struct child_process {
+public:
+    int pid { -1 };
+    command_output output { command_output::captured };
+    // read end of the output pipe, only valid if the output is captured
+    int output_fd { -1 };
+    // descriptor that becomes readable once the child exits, -1 where pidfds are not supported
+    int pid_fd { -1 };
+    // whether the terminal was given to the child, it is taken back once the child is waited for
+    bool has_terminal { false };
+    std::chrono::steady_clock::time_point start_time {};
+};
+
+struct command_result {
+public:
+    // exit code of the command, or 128 + signal number if it was killed by a signal (like shells report it)
+    int exit_code { 0 };
+    std::optional<int> signal {};
+    std::chrono::nanoseconds wall_time {};
+    // standard output and error of the command, only filled in by os::run_command with captured output
+    std::string output {};
+
+    bool succeeded() const { return exit_code == 0; }
+};
+
+// resource usage of lppm itself (and of the commands it started), as far as the system reports it
+struct process_usage {
+public:
+    // read and write system calls (of any kind, including the ones done by the kernel for io_uring) and the number of
+    // bytes they transferred, all zero if the system does not account them
+    u64 read_calls { 0 };
+    u64 write_calls { 0 };
+    u64 read_bytes { 0 };
+    u64 written_bytes { 0 };
+    u64 peak_resident_bytes { 0 };
+    // peak of the biggest command that finished and was waited for
+    u64 children_peak_resident_bytes { 0 };
+};
+
+// where a file or a directory is created - the whole path, and optionally a descriptor of an open directory together
+// with the position in the path where the part relative to that directory starts, in which case the entry is created
+// relative to the descriptor, without resolving the whole path again
+struct entry_location {
+public:
+    static constexpr int no_descriptor = -1;
+
+    std::string path;
+    int directory_fd { no_descriptor };
+    usz relative_offset { 0 };
+    // whether a symbolic link in place of an existing entry is followed when it is opened - entries known to be
+    // regular files are opened without following links, so they cannot be replaced by one in the meantime
+    bool follows_link { true };
+
+    const c8* relative_path() const {
+        return directory_fd == no_descriptor ? path.c_str() : path.c_str() + relative_offset;
+    }
+};
+
 class os {
 public:
     static std::string get_user_directory();
     static std::string get_lppm_config_directory();
     static std::string get_working_directory();
-    static bool set_working_directory(const std::string& new_wd);
     static void ensure_directory_exists(const std::string& path);
-    static int run_command(const std::string& command);
+
+    // commands are spawned directly if they do not use any shell features, otherwise through /bin/sh -c - either way
+    // the working directory (and resource limits, if there are any) are set only in the child
+    static std::variant<std::string, command_result>
+    run_command(const std::string& command, const std::string& working_directory,
+                command_output output = command_output::inherited);
+    static std::variant<std::string, child_process>
+    start_command(const std::string& command, const std::string& working_directory,
+                  command_output output = command_output::captured, const resource_limits& limits = {});
+    static command_result wait_for_child(const child_process& child);
+    // reaps the child if it has already exited, without blocking - its output may still be open (and even be kept open
+    // by something it started), so exiting has to be checked separately from the end of the output
+    static std::optional<command_result> try_wait_for_child(const child_process& child);
+    // sends SIGTERM (or SIGKILL) to the child and everything it started, that is to its whole process group
+    static void terminate_child(const child_process& child);
+    static void kill_child(const child_process& child);
+    static usz available_cpu_count();
+    static process_usage current_process_usage();
+    static std::optional<std::string> copy_file(const entry_location& source, const entry_location& target);
+
+    // directories may be kept open, so entries inside of them can be created relative to them - where descriptors are
+    // not supported, no_descriptor is returned instead and whole paths are always used
+    static int open_directory(const entry_location& location);
+    // returns a descriptor of the file opened for reading, or -1 with errno set
+    static int open_file(const entry_location& location);
+    static void close_directory(int directory_fd);
+    // creates missing parents too, unless the location is relative to a descriptor - existing directories are fine
+    static std::optional<std::string> create_directory(const entry_location& location);
+    static std::optional<std::string> write_file(const entry_location& location, std::string_view contents);
+    // everyone who can read the file may execute it as well, like with chmod +x under the default umask
+    static std::optional<std::string> make_executable(const entry_location& location);
 };
 
 } // namespace lppm
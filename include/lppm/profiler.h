@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/os.h>
+
+namespace lppm {
+
+// collects timings of the phases of an operation (as spans recorded by every thread separately) and counters of the
+// work done in them - it is enabled only by the --stats and --trace-json options, until then recording a span or a
+// counter costs a single relaxed load
+// the summary is printed in a human readable form, while the trace is written in the Chrome trace event format, with
+// one track for every thread and for every template command, so it can be opened in Perfetto or chrome://tracing
+class profiler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class counter : usz {
+        entries_walked,
+        files_scanned,
+        bytes_scanned,
+        files_read,
+        bytes_read,
+        markers_substituted,
+        names_substituted,
+        files_rendered,
+        bytes_rendered,
+        files_copied,
+        bytes_copied,
+        directories_created,
+        commands_run,
+    };
+    static constexpr usz counter_count = static_cast<usz>(counter::commands_run) + 1;
+
+    static profiler& the();
+
+    void enable();
+    bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    void count(counter which, u64 value = 1) {
+        if (is_enabled())
+            m_counters[static_cast<usz>(which)].fetch_add(value, std::memory_order_relaxed);
+    }
+    // the name has to outlive the profiler (it is a string literal everywhere), the detail is copied
+    void record_span(std::string_view name, clock::time_point start, clock::time_point end,
+                     std::string_view detail = {});
+    void record_command(usz index, std::string_view command, clock::time_point start,
+                        std::chrono::nanoseconds wall_time, int exit_code);
+
+    void print_summary() const;
+    std::optional<std::string> write_trace(const std::string& path) const;
+
+private:
+    struct span {
+    public:
+        std::string_view name;
+        std::string detail;
+        clock::time_point start;
+        clock::time_point end;
+    };
+
+    struct thread_spans {
+    public:
+        usz thread_index;
+        std::vector<span> spans {};
+    };
+
+    struct command_record {
+    public:
+        usz index;
+        std::string command;
+        clock::time_point start;
+        std::chrono::nanoseconds wall_time;
+        int exit_code;
+    };
+
+    profiler() = default;
+
+    thread_spans& current_thread_spans();
+
+    static inline profiler* s_the { nullptr };
+    static inline thread_local thread_spans* s_current_spans { nullptr };
+
+    std::atomic<bool> m_enabled { false };
+    clock::time_point m_start_time {};
+    process_usage m_start_usage {};
+    std::array<std::atomic<u64>, counter_count> m_counters {};
+
+    mutable std::mutex m_mutex {};
+    std::vector<std::unique_ptr<thread_spans>> m_threads {};
+    std::vector<command_record> m_commands {};
+};
+
+// records a span from its construction to its destruction, if the profiler is enabled
+class profile_span {
+public:
+    explicit profile_span(std::string_view name, std::string_view detail = {});
+    ~profile_span();
+
+    profile_span(const profile_span&) = delete;
+    profile_span& operator=(const profile_span&) = delete;
+
+private:
+    std::string_view m_name;
+    std::string m_detail {};
+    std::optional<profiler::clock::time_point> m_start {};
+};
+
+} // namespace lppm
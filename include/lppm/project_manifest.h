@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace lppm {
+
+// list of projects to be created from a single template at once, with values of variables for every one of them:
+// LPPM PROJECTS V1
+// template <template name>
+//
+// [project <target directory>]
+// <variable name>: <value>
+//
+// empty lines and lines starting with # are ignored, variables given here take precedence over the global ones
+class project_manifest {
+public:
+    struct project {
+    public:
+        std::string target_path;
+        std::map<std::string, std::string> variables {};
+    };
+
+    static std::variant<std::string, project_manifest> parse_from_file(const std::string& path);
+    static std::variant<std::string, project_manifest> parse_from_text(std::string_view contents,
+                                                                       const std::string& path);
+
+    const std::string& template_name() const;
+    const std::vector<project>& projects() const;
+
+private:
+    project_manifest() = default;
+
+    static inline std::string header_string_v1 = std::string { "LPPM PROJECTS V1" };
+
+    std::string m_template_name {};
+    std::vector<project> m_projects {};
+};
+
+} // namespace lppm
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+enum class marker_scanner_kind {
+    scalar,
+    sse2,
+    avx2,
+};
+
+// finds the first "@@" marker delimiter at or after the from index, returns std::string_view::npos if there is
+// none - the fastest scanner supported by the CPU is selected at runtime
+usz find_marker(std::string_view text, usz from = 0);
+
+// same as find_marker, but uses the given scanner implementation (it must be supported by the CPU)
+usz find_marker_with(marker_scanner_kind kind, std::string_view text, usz from = 0);
+
+marker_scanner_kind active_marker_scanner();
+std::vector<marker_scanner_kind> supported_marker_scanners();
+const char* marker_scanner_name(marker_scanner_kind kind);
+
+} // namespace lppm
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// incremental SHA-256, used to address file contents in the blob store
+class sha256 {
+public:
+    sha256();
+
+    void update(std::string_view data);
+    // finishes the hash, the object should not be updated afterwards
+    std::array<u8, 32> finish();
+
+    static std::string hex_digest(std::string_view data);
+
+private:
+    void process_block(const u8* block);
+
+    std::array<u32, 8> m_state;
+    std::array<u8, 64> m_buffer {};
+    usz m_buffer_size { 0 };
+    u64 m_total_size { 0 };
+};
+
+} // namespace lppm
@@ -1,10 +1,79 @@
 #pragma once
 
+#include <functional>
 #include <map>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
 
 namespace lppm {
 
+// returns the value of a variable with given name, the returned reference must stay valid until rendering finishes
+using variable_resolver = std::function<const std::string&(const std::string& variable_name)>;
+
+// returns the value of a variable from mappings, asks the user for it if it is not mapped yet
+const std::string& resolve_variable(const std::string& variable_name, std::map<std::string, std::string>& mappings);
+
+// compiled representation of a text containing @@VARIABLE@@ markers - the text is scanned only once, producing
+// a list of literal spans and variable slots, which can later be rendered any number of times
+// NOTE: compiled_text does not own the text, it must outlive the compiled_text object
+class compiled_text {
+public:
+    static constexpr usz literal_segment = static_cast<usz>(-1);
+
+    struct segment {
+        usz offset;
+        usz length;
+        usz variable_index { literal_segment };
+
+        bool is_literal() const { return variable_index == literal_segment; }
+    };
+
+    static compiled_text compile(std::string_view text);
+    static std::optional<compiled_text> from_markers(std::string_view text, const std::vector<segment>& markers,
+                                                     std::vector<std::string> variables);
+
+    std::string_view text() const;
+    const std::vector<segment>& segments() const;
+    const std::vector<std::string>& variables() const;
+    bool has_markers() const;
+
+    std::vector<const std::string*> resolve_values(const variable_resolver& resolver) const;
+    std::vector<const std::string*> resolve_values(std::map<std::string, std::string>& mappings) const;
+    std::string render(const std::vector<const std::string*>& values) const;
+    std::string render(std::map<std::string, std::string>& mappings) const;
+
+private:
+    explicit compiled_text(std::string_view text);
+
+    std::string_view m_text {};
+    std::vector<segment> m_segments {};
+    std::vector<std::string> m_variables {};
+};
+
 std::string do_the_substitutions(const std::string& text, std::map<std::string, std::string>& mappings);
+std::string do_the_substitutions(const std::string& text, const variable_resolver& resolver);
+
+// renders the file at source_path into target_path in chunks, so the peak memory usage is bounded by the chunk size
+// (and the maximal variable name length) regardless of the file size - the output is the same as the output of
+// do_the_substitutions, except for variable names longer than max_streamed_variable_name_length, which are rejected
+static constexpr usz default_stream_chunk_size = 1024 * 1024;
+static constexpr usz max_streamed_variable_name_length = 64 * 1024;
+
+std::optional<std::string> stream_substitutions(const std::string& source_path, const std::string& target_path,
+                                                const variable_resolver& resolver,
+                                                usz chunk_size = default_stream_chunk_size);
+std::optional<std::string> stream_substitutions(const std::string& source_path, const std::string& target_path,
+                                                std::map<std::string, std::string>& mappings,
+                                                usz chunk_size = default_stream_chunk_size);
+
+// returns unique names of variables used in the file at source_path (in order of first appearance), reading it in
+// chunks the same way stream_substitutions does
+std::variant<std::string, std::vector<std::string>>
+stream_variable_names(const std::string& source_path, usz chunk_size = default_stream_chunk_size);
 
 } // namespace lppm
@@ -1,36 +1,44 @@
 #pragma once
-#include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <variant>
 
 #include <lppm/template_info.h>
+#include <lppm/template_pack.h>
 
 namespace lppm {
 
+// a template is either a directory with the template info file, or a single packed file with the same name and the
+// .lppmpack extension next to where the directory would be - both are loaded through template_from_directory
 class project_template {
 public:
     static inline std::string template_info_file_name = ".lppm_template";
     static inline std::string templates_directory_name = "templates";
 
-    static std::map<std::string, project_template> get_all_templates();
     static std::variant<std::string, project_template> template_from_directory(const std::string& directory_path);
+    static std::variant<std::string, project_template> template_from_pack(const std::string& pack_path);
     static std::variant<std::string, project_template>
     create_new_template(std::string template_name, std::optional<std::string> maybe_source_directory = {},
                         bool should_write_empty_info = true);
     static std::variant<std::string, project_template> import_template(const std::string& template_name,
                                                                        const std::string& source_directory);
 
+    // path of the template directory, or of the pack file for packed templates
     const std::string& base_directory() const;
     const template_info& info() const;
+    template_info& info();
+    bool is_packed() const;
+    const template_pack* pack() const;
 
     std::optional<std::string> save_info() const;
 
 private:
-    project_template(std::string base_directory, template_info info);
+    project_template(std::string base_directory, template_info info, std::shared_ptr<template_pack> pack = {});
 
     std::string m_base_directory {};
     template_info m_info;
+    std::shared_ptr<template_pack> m_pack {};
 };
 
 } // namespace lppm
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/file_contents.h>
+#include <lppm/os.h>
+#include <lppm/substitutor.h>
+
+namespace lppm {
+
+// persistent index of template file contents, stored next to the template info file - for every file it records
+// its size and modification time (to detect changes), how it should be instantiated, the variables used in it and
+// positions of all variable markers, so instantiating a project does not have to scan unchanged files again
+class template_index {
+public:
+    static inline std::string index_file_name = ".lppm_index";
+
+    enum class content_kind {
+        binary,
+        verbatim,
+        rendered,
+        streamed,
+    };
+
+    struct file_entry {
+    public:
+        u64 size { 0 };
+        i64 modification_time { 0 };
+        content_kind kind { content_kind::verbatim };
+        std::vector<std::string> variables {};
+        std::vector<compiled_text::segment> markers {};
+    };
+
+    // files of at least this size are scanned (and rendered) in chunks, their marker positions are not recorded
+    static constexpr usz streamed_file_threshold = 16 * 1024 * 1024;
+
+    static template_index load(const std::string& template_directory);
+    static std::variant<std::string, template_index> build(const std::string& template_directory);
+    static std::variant<std::string, file_entry> scan_file(const entry_location& location, u64 size,
+                                                           i64 modification_time,
+                                                           std::optional<file_contents>* contents = nullptr,
+                                                           bool detect_binary = true);
+    static bool is_template_metadata_file(const std::string& file_name);
+
+    std::optional<std::string> save(const std::string& template_directory) const;
+
+    const file_entry* find_fresh(const std::string& relative_path, u64 size, i64 modification_time) const;
+    void update(const std::string& relative_path, file_entry entry);
+    void retain_only(const std::vector<std::string>& relative_paths);
+    bool is_modified() const;
+
+private:
+    template_index() = default;
+
+    static inline std::string header_string_v1 = std::string { "LPPM INDEX V1" };
+
+    // NOTE: the index is not synchronized, concurrent updates have to be guarded by the caller
+    std::map<std::string, file_entry> m_entries {};
+    bool m_modified { false };
+};
+
+} // namespace lppm
@@ -1,27 +1,128 @@
 #pragma once
 #include <map>
+#include <ostream>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
+#include <lppm/common.h>
+#include <lppm/os.h>
+#include <lppm/variable_scope.h>
+
 namespace lppm {
 
+enum class command_limit {
+    timeout,
+    cpu_time,
+    memory,
+};
+
+struct command_settings {
+public:
+    std::optional<std::vector<usz>> dependencies {};
+    std::optional<u64> timeout_seconds {};
+    resource_limits limits {};
+    // directory (relative to the instantiated project) the command is run in, variables are substituted in it
+    std::optional<std::string> directory {};
+};
+
+// what is done with the template entries matching a path rule:
+// - render: the file is always rendered, even if it looks like a binary file,
+// - copy: the file is copied as it is, without looking for variables in it,
+// - skip: the entry (and everything inside it, if it is a directory) is not instantiated at all,
+// - executable: the instantiated file is made executable (this does not change how its contents are handled)
+enum class path_action {
+    render,
+    copy,
+    skip,
+    executable,
+};
+
+struct path_rule {
+public:
+    path_action action;
+    std::string pattern;
+};
+
+// actions of all the rules matching a single path
+struct path_actions {
+public:
+    // render, copy or skip - the last matching rule wins
+    std::optional<path_action> contents {};
+    bool executable { false };
+};
+
+std::string_view path_action_name(path_action action);
+std::optional<path_action> parse_path_action(std::string_view name);
+
 class template_info {
 public:
     explicit template_info(std::vector<std::string> commands);
 
     static std::variant<std::string, template_info> parse_from_file(const std::string& path);
+    // the path is only used in error messages
+    static std::variant<std::string, template_info> parse_from_text(std::string_view contents,
+                                                                    const std::string& path);
+    // infos read from V1 files are saved as V1 again, unless they use features V1 files cannot hold (path rules,
+    // default values, command directories or multi-line commands) - then they are upgraded to V2
     std::optional<std::string> save_to_file(const std::string& path) const;
+    std::string save_to_text() const;
+    bool is_upgraded_on_save() const;
 
     std::vector<std::string>& commands() const;
-    std::optional<std::string> run_commands_at(std::string directory_path,
-                                               std::map<std::string, std::string>& mappings) const;
+    void add_command(std::string command);
+    void remove_command(usz index);
+
+    // every command may declare the commands (with lower indices) it depends on - commands without a declaration
+    // depend on the previous command, so templates without declarations run their commands one after another
+    const command_settings& settings_of(usz index) const;
+    std::vector<usz> dependencies_of(usz index) const;
+    std::optional<std::string> set_dependencies(usz index, std::optional<std::vector<usz>> dependencies);
+    std::optional<std::string> set_limit(usz index, command_limit limit, std::optional<u64> value);
+    std::optional<std::string> set_directory(usz index, std::optional<std::string> directory);
+
+    // limits the time all commands of the template may take together
+    std::optional<u64> timeout_seconds() const;
+    void set_timeout_seconds(std::optional<u64> timeout_seconds);
+
+    // patterns of the rules are globs matched against paths relative to the template root - patterns containing a
+    // slash are anchored at the root, other ones match the name of any entry - a pattern also matches everything
+    // inside the directories it matches, and a trailing slash makes it match directories only
+    const std::vector<path_rule>& path_rules() const;
+    std::optional<std::string> add_path_rule(path_rule rule);
+    void remove_path_rule(usz index);
+    path_actions actions_for(std::string_view relative_path, bool is_directory) const;
+
+    // default values of variables, they take precedence over globals, but not over project or command line values
+    const std::map<std::string, std::string>& default_values() const;
+    // sets the default value of a variable, or removes it if the value is not given
+    std::optional<std::string> set_default_value(std::string name, std::optional<std::string> value);
+
+    // runs the commands in the order given by their dependencies, at most max_parallel of them at once - commands
+    // exceeding their timeout (or the timeout of the whole template) are terminated and reported as failures
+    std::optional<std::string> run_commands_at(std::string directory_path, variable_scope& scope,
+                                               usz max_parallel = 1) const;
 
 private:
+    static std::variant<std::string, template_info> parse_v1(std::string_view contents, const std::string& path);
+    static std::variant<std::string, template_info> parse_v2(std::string_view contents, const std::string& path);
+    std::optional<std::string> parse_settings_line(const std::string& line);
+    bool fits_v1() const;
+    void write_to(std::ostream& stream) const;
+    void write_v1_to(std::ostream& stream) const;
+
     static inline std::string header_string_v1 = std::string { "LPPM TEMPLATE V1" };
+    static inline std::string header_string_v2 = std::string { "LPPM TEMPLATE V2" };
 
+    // version of the format the info was read in, new infos are written as V2
+    u32 m_format_version { 2 };
     mutable std::vector<std::string> m_commands {};
+    std::vector<command_settings> m_settings {};
+    std::optional<u64> m_timeout_seconds {};
+    std::vector<path_rule> m_path_rules {};
+    std::map<std::string, std::string> m_default_values {};
 };
 
 } // namespace lppm
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/file_contents.h>
+#include <lppm/template_index.h>
+
+namespace lppm {
+
+// a whole template stored in a single file, which is read with a single mapping - the file consists of:
+// - a header: "LPPMPACK" magic, format version (u32), entry count (u32), template info size (u64) and index size (u64),
+// - contents of the template info file,
+// - an index with a record for every entry, in the walk order (so directories come before their contents): path size
+//   (u32), mode (u32), type (u8, directory or file), content kind (u8, as in the template index), variable count (u32),
+//   offset of the contents from the start of the data section (u64), size of the contents (u64), the path itself and
+//   names of the variables used in the file (u32 size followed by the name each),
+// - a data section with the contents of all files one after another
+// all numbers are stored in little endian
+class template_pack {
+public:
+    static inline std::string file_extension = ".lppmpack";
+    static constexpr u32 format_version = 1;
+
+    enum class entry_type : u8 {
+        directory,
+        file,
+    };
+
+    struct entry {
+    public:
+        std::string path;
+        u32 mode { 0 };
+        entry_type type { entry_type::file };
+        template_index::content_kind kind { template_index::content_kind::verbatim };
+        std::vector<std::string> variables {};
+        // points into the mapped pack
+        std::string_view contents {};
+    };
+
+    static std::variant<std::string, template_pack> open(const std::string& pack_path);
+    // packs the template directory (without its index and entries ignored by its .lppmignore file)
+    static std::optional<std::string> pack_directory(const std::string& template_directory,
+                                                     const std::string& pack_path);
+
+    std::string_view info_text() const;
+    const std::vector<entry>& entries() const;
+
+    // writes the same pack again with a different template info
+    std::optional<std::string> rewrite_with_info(const std::string& pack_path, std::string_view info_text) const;
+    // recreates the template directory (without the index, which is built separately)
+    std::optional<std::string> unpack_to(const std::string& template_directory) const;
+
+private:
+    // entry to be written - contents are read from the source path, unless it is empty
+    struct pending_entry {
+    public:
+        entry description;
+        u64 size { 0 };
+        std::string source_path {};
+    };
+
+    static std::optional<std::string> write(const std::string& pack_path, std::string_view info_text,
+                                            const std::vector<pending_entry>& entries);
+
+    template_pack(file_contents contents) : m_contents(std::move(contents)) {}
+
+    file_contents m_contents;
+    std::string_view m_info_text {};
+    std::vector<entry> m_entries {};
+};
+
+} // namespace lppm
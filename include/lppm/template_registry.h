@@ -0,0 +1,51 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// list of all templates, kept in a single file in the lppm config directory - listing templates reads just this file
+// instead of the whole templates directory and the info files of all templates
+// the list is valid as long as the modification time of the templates directory is the one it was written with,
+// otherwise it is built again from the entries of the templates directory (template info files are never read for it,
+// directories without one are just not listed)
+// operations adding, removing or replacing templates take the time of the directory before they start and update the
+// list afterwards, so it only has to be built again after changes made outside of lppm
+class template_registry {
+public:
+    static inline std::string registry_file_name = "templates.registry";
+
+    struct entry {
+    public:
+        std::string name;
+        bool is_packed { false };
+    };
+
+    // all templates, sorted by name
+    static std::vector<entry> list();
+    // absolute path of the template directory, or of the pack file for packed templates
+    static std::string path_of(const entry& template_entry);
+
+    // modification time of the templates directory, if it exists
+    static std::optional<i64> directory_time();
+    // looks at the template with given name again - the previous time is the directory time taken before the template
+    // was changed, if the list was written with a different time, it is built again instead
+    static void update(const std::string& name, std::optional<i64> previous_time);
+
+private:
+    static std::optional<std::vector<entry>> load(i64 expected_time);
+    static std::vector<entry> scan();
+    static void save(const std::vector<entry>& entries, i64 directory_time);
+    static std::optional<entry> find_template(const std::string& name);
+
+    static std::string templates_directory_path();
+    static std::string registry_file_path();
+
+    static inline std::string header_string_v1 = "LPPM REGISTRY V1";
+};
+
+} // namespace lppm
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// fixed-size pool of worker threads, each with its own task queue - workers take tasks from the back of their own
+// queue and steal from the front of the other queues when they run out of work
+class thread_pool {
+public:
+    using task = std::function<void()>;
+
+    explicit thread_pool(usz worker_count);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    void submit(task new_task);
+    void wait();
+
+    usz worker_count() const;
+    // returns index of the worker running the calling thread, if it is one of the workers of this pool
+    std::optional<usz> current_worker_index() const;
+
+private:
+    struct task_queue {
+        std::mutex mutex {};
+        std::deque<task> tasks {};
+    };
+
+    void run_worker(usz worker_index);
+    bool try_take_task(usz worker_index, task& result);
+
+    static inline thread_local const thread_pool* s_current_pool { nullptr };
+    static inline thread_local usz s_current_worker_index { 0 };
+
+    std::vector<std::unique_ptr<task_queue>> m_queues {};
+    std::vector<std::thread> m_workers {};
+    std::atomic<usz> m_next_queue { 0 };
+
+    std::mutex m_state_mutex {};
+    std::condition_variable m_work_available {};
+    std::condition_variable m_work_finished {};
+    std::atomic<usz> m_queued_count { 0 };
+    usz m_unfinished_count { 0 };
+    bool m_stopping { false };
+};
+
+} // namespace lppm
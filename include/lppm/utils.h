@@ -2,6 +2,9 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
+
+#include <lppm/common.h>
 
 namespace lppm {
 
@@ -12,7 +15,20 @@ std::string trim_string_right(std::string input);
 void trim_string_in_place(std::string& input);
 void trim_string_left_in_place(std::string& input);
 void trim_string_right_in_place(std::string& input);
+std::string_view trim_string_view(std::string_view input);
 
 std::optional<std::string> read_all_text(const std::string& path);
+std::optional<std::string> read_file_prefix(const std::string& path, std::size_t size);
+// name of a temporary file next to path, unique enough that concurrent writers of the same file never share it - the
+// file is meant to be renamed over path once it is written
+std::string unique_temporary_path(const std::string& path);
+
+static constexpr std::size_t binary_detection_prefix_size = 8000;
+bool looks_like_binary(std::string_view contents);
+
+// parses a duration given in seconds, optionally with a unit suffix (s, m, h or d), into seconds
+std::optional<u64> parse_duration_seconds(std::string_view text);
+// parses a size given in bytes, optionally with a binary unit suffix (K, M, G or T), into bytes
+std::optional<u64> parse_byte_size(std::string_view text);
 
 } // namespace lppm
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// values of variables visible to a single project, looked up in layers - the first layer with a value wins:
+// - overrides: values given on the command line (with -D and --vars-file),
+// - project: values specific to the project (like PROJECT_NAME or the ones from a manifest) and values the user was
+//   asked for,
+// - template defaults: values declared in the [defaults] section of the template info file,
+// - globals: global replacement variables,
+// - environment: LPPM_VAR_<name> environment variables
+// only the project layer is owned by the scope, the other ones are borrowed and must outlive it
+class variable_scope {
+public:
+    enum class layer : usz {
+        overrides,
+        project,
+        template_defaults,
+        globals,
+        environment,
+    };
+    static constexpr usz layer_count = static_cast<usz>(layer::environment) + 1;
+    static constexpr std::string_view environment_prefix = "LPPM_VAR_";
+
+    // the overrides, globals and environment layers are set up right away
+    explicit variable_scope(const std::map<std::string, std::string>* template_defaults = nullptr);
+
+    void set_layer(layer which, const std::map<std::string, std::string>* values);
+    std::map<std::string, std::string>& project_values();
+
+    // returns the value from the first layer which has it, or nullptr - returned pointers stay valid as long as the
+    // layers do not change
+    const std::string* find(const std::string& name) const;
+    std::optional<layer> layer_of(const std::string& name) const;
+    // like find, but asks the user for values which are missing and stores them in the project layer
+    const std::string& resolve(const std::string& name);
+
+    static std::string_view layer_name(layer which);
+    // all LPPM_VAR_* variables from the environment of the process, without the prefix
+    static const std::map<std::string, std::string>& environment_values();
+
+private:
+    const std::map<std::string, std::string>* layer_values(usz index) const;
+
+    std::map<std::string, std::string> m_project_values {};
+    // the entry of the project layer is unused, so scopes can be copied
+    std::array<const std::map<std::string, std::string>*, layer_count> m_layers {};
+};
+
+} // namespace lppm
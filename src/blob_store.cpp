@@ -0,0 +1,239 @@
+#include <lppm/blob_store.h>
+
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/file_contents.h>
+#include <lppm/os.h>
+#include <lppm/sha256.h>
+#include <lppm/utils.h>
+
+namespace lppm {
+
+static constexpr std::string_view manifest_header = "LPPM MANIFEST V1";
+static constexpr std::string_view executable_suffix = "-x";
+// suffix of the names given by unique_temporary_path
+static constexpr std::string_view temporary_suffix = ".tmp";
+
+// temporary files older than this are left over from an interrupted store and are removed by the garbage collection
+static constexpr auto stale_temporary_age = std::chrono::hours { 1 };
+
+static bool is_executable(std::filesystem::perms permissions) {
+    using std::filesystem::perms;
+    return (permissions & (perms::owner_exec | perms::group_exec | perms::others_exec)) != perms::none;
+}
+
+// writes the blob under a unique temporary name and links it into place - if another process stored the same blob in
+// the meantime, its blob is kept, so files already linked to it stay shared
+static std::optional<std::string> write_blob(const std::string& path, std::string_view contents, bool executable) {
+    std::error_code code {};
+    std::filesystem::create_directories(std::filesystem::path { path }.parent_path(), code);
+    if (code)
+        return std::format("cannot create directory for blob `{}` - {}", path, code.message());
+
+    std::string temporary_path = unique_temporary_path(path);
+    {
+        std::ofstream file { temporary_path, std::ios::binary };
+        if (!file || !file.write(contents.data(), static_cast<std::streamsize>(contents.size())) || !file.flush()) {
+            std::filesystem::remove(temporary_path, code);
+            return std::format("cannot write blob `{}`", temporary_path);
+        }
+    }
+
+    // blobs are shared between templates, so they must never be modified in place
+    using std::filesystem::perms;
+    auto permissions = perms::owner_read | perms::group_read | perms::others_read;
+    if (executable)
+        permissions |= perms::owner_exec | perms::group_exec | perms::others_exec;
+    std::filesystem::permissions(temporary_path, permissions, code);
+    if (!code)
+        std::filesystem::create_hard_link(temporary_path, path, code);
+    auto link_code = code;
+    std::filesystem::remove(temporary_path, code);
+    if (link_code && link_code != std::errc::file_exists)
+        return std::format("cannot store blob `{}` - {}", path, link_code.message());
+    return {};
+}
+
+std::string blob_store::blobs_directory() {
+    return std::filesystem::path { os::get_lppm_config_directory() } / store_directory_name / "blobs";
+}
+
+std::string blob_store::blob_path(const std::string& blob_name) {
+    // blobs are spread over subdirectories named after the first byte of their hash, to keep directories small
+    return std::filesystem::path { blobs_directory() } / blob_name.substr(0, 2) / blob_name;
+}
+
+std::variant<std::string, blob_store::manifest_entry> blob_store::add_file(const std::string& source_path,
+                                                                           const std::string& target_path,
+                                                                           const std::string& relative_path) {
+    std::error_code code {};
+    auto status = std::filesystem::status(source_path, code);
+    if (code)
+        return std::format("could not read attributes of file `{}` - {}", source_path, code.message());
+    bool executable = is_executable(status.permissions());
+
+    auto maybe_contents = file_contents::read(source_path);
+    if (std::holds_alternative<std::string>(maybe_contents))
+        return std::get<std::string>(maybe_contents);
+    auto contents = std::get<file_contents>(maybe_contents).view();
+
+    manifest_entry entry { sha256::hex_digest(contents), contents.size(), relative_path };
+    if (executable)
+        entry.blob_name += executable_suffix;
+    auto path = blob_path(entry.blob_name);
+
+    // the blob may be collected between the check and linking to it, in which case it is simply stored again
+    for (usz attempt = 0; attempt < 3; attempt++) {
+        if (std::error_code exists_code; !std::filesystem::exists(path, exists_code)) {
+            if (auto result = write_blob(path, contents, executable); result.has_value())
+                return result.value();
+        }
+
+        std::filesystem::create_hard_link(path, target_path, code);
+        if (!code)
+            return entry;
+        if (code == std::errc::no_such_file_or_directory)
+            continue;
+
+        // templates on another filesystem than the store (or blobs with too many links) get their own copy
+        if (code == std::errc::cross_device_link || code == std::errc::operation_not_permitted ||
+            code == std::errc::too_many_links) {
+            std::filesystem::copy_file(source_path, target_path, code);
+            if (code)
+                return std::format("cannot copy `{}` - {}", source_path, code.message());
+            return entry;
+        }
+        return std::format("cannot link `{}` to blob `{}` - {}", target_path, path, code.message());
+    }
+    return std::format("blob `{}` keeps disappearing while being linked to", path);
+}
+
+std::optional<std::string> blob_store::write_manifest(const std::string& template_directory,
+                                                      const std::vector<manifest_entry>& entries) {
+    std::string manifest_path = std::filesystem::path { template_directory } / manifest_file_name;
+    std::ofstream file { manifest_path, std::ios::binary };
+    if (!file)
+        return std::format("cannot open file `{}` for writing", manifest_path);
+
+    // the path goes last, so it can contain spaces
+    file << manifest_header << '\n';
+    for (auto& entry : entries)
+        file << entry.blob_name << ' ' << entry.size << ' ' << entry.relative_path << '\n';
+    if (!file.flush())
+        return std::format("cannot write file `{}`", manifest_path);
+    return {};
+}
+
+std::vector<blob_store::manifest_entry> blob_store::read_manifest(const std::string& template_directory) {
+    // templates created before the store existed have no manifest, they simply do not reference any blobs
+    std::vector<manifest_entry> entries {};
+    auto text = read_all_text(std::filesystem::path { template_directory } / manifest_file_name);
+    if (!text.has_value())
+        return entries;
+
+    std::string_view remaining { text.value() };
+    bool is_first_line = true;
+    while (!remaining.empty()) {
+        auto line_end = remaining.find('\n');
+        auto line = remaining.substr(0, line_end);
+        remaining = line_end == std::string_view::npos ? std::string_view {} : remaining.substr(line_end + 1);
+        if (std::exchange(is_first_line, false)) {
+            if (line != manifest_header)
+                return {};
+            continue;
+        }
+
+        auto name_end = line.find(' ');
+        auto size_end = name_end == std::string_view::npos ? name_end : line.find(' ', name_end + 1);
+        if (size_end == std::string_view::npos)
+            continue;
+        u64 size = 0;
+        auto size_text = line.substr(name_end + 1, size_end - name_end - 1);
+        auto [size_text_end, error] = std::from_chars(size_text.data(), size_text.data() + size_text.size(), size);
+        auto blob_name = line.substr(0, name_end);
+        if (error != std::errc {} || size_text_end != size_text.data() + size_text.size() || blob_name.size() < 2 ||
+            blob_name.find('/') != std::string_view::npos)
+            continue;
+        entries.push_back({ std::string { blob_name }, size, std::string { line.substr(size_end + 1) } });
+    }
+    return entries;
+}
+
+std::optional<std::string> blob_store::remove_template_directory(const std::string& template_directory) {
+    auto entries = read_manifest(template_directory);
+    std::error_code code {};
+    std::filesystem::remove_all(template_directory, code);
+    if (code)
+        return std::format("cannot remove directory `{}` - {}", template_directory, code.message());
+    release(entries);
+    return {};
+}
+
+blob_store::collection_result blob_store::release(const std::vector<manifest_entry>& entries) {
+    // the only remaining link of an unused blob is the one in the store itself
+    collection_result result {};
+    std::set<std::string_view> released {};
+    for (auto& entry : entries) {
+        if (!released.insert(entry.blob_name).second)
+            continue;
+        auto path = blob_path(entry.blob_name);
+        std::error_code code {};
+        if (std::filesystem::hard_link_count(path, code) != 1 || code)
+            continue;
+        if (std::filesystem::remove(path, code) && !code) {
+            result.removed_blobs++;
+            result.removed_bytes += entry.size;
+        }
+    }
+    return result;
+}
+
+std::variant<std::string, blob_store::collection_result> blob_store::collect_garbage() {
+    collection_result result {};
+    auto directory = blobs_directory();
+    std::error_code code {};
+    if (!std::filesystem::is_directory(directory, code) || code)
+        return result;
+
+    auto now = std::filesystem::file_time_type::clock::now();
+    for (std::filesystem::recursive_directory_iterator iterator { directory, code }, end {};
+         !code && iterator != end; iterator.increment(code)) {
+        auto& directory_entry = *iterator;
+        std::error_code entry_code {};
+        if (!directory_entry.is_regular_file(entry_code) || entry_code)
+            continue;
+
+        // temporary files of a store that is still in progress are left alone
+        auto size = directory_entry.file_size(entry_code);
+        if (directory_entry.path().extension() == temporary_suffix) {
+            if (now - directory_entry.last_write_time(entry_code) < stale_temporary_age || entry_code)
+                continue;
+        } else if (directory_entry.hard_link_count(entry_code) != 1 || entry_code) {
+            continue;
+        }
+
+        if (std::filesystem::remove(directory_entry.path(), entry_code) && !entry_code) {
+            result.removed_blobs++;
+            result.removed_bytes += size;
+        }
+    }
+    if (code)
+        return std::format("could not read blob store directory `{}` - {}", directory, code.message());
+    return result;
+}
+
+} // namespace lppm
@@ -1,11 +1,13 @@
 #include <algorithm>
 #include <cctype>
 #include <cstdlib>
+#include <format>
 #include <iostream>
 #include <string>
 
 #include <lppm/cli.h>
 #include <lppm/common.h>
+#include <lppm/options.h>
 #include <lppm/utils.h>
 
 namespace lppm {
@@ -32,6 +34,10 @@ void print_fatal(const std::string& message) { std::cerr << STYLE_RED << "fatal:
 }
 
 std::string prompt_user_input(const std::string& prompt, const std::string& default_value, bool skip_default_text) {
+    // nobody is there to answer in non-interactive mode
+    if (options::the().prompts() != prompt_policy::interactive)
+        print_fatal_and_exit(std::format("cannot ask for input in non-interactive mode - {}", prompt));
+
     std::string result {};
 
     while (true) {
@@ -41,7 +47,10 @@ std::string prompt_user_input(const std::string& prompt, const std::string& defa
             ? std::cout << std::string { " [" } + (skip_default_text ? "" : STYLE_BLUE "default: ") + STYLE_YELLOW
                         << default_value << STYLE_RESET "]: "
             : std::cout << ": ";
-        std::getline(std::cin, result);
+        if (!std::getline(std::cin, result)) {
+            std::cout << "\n";
+            print_fatal_and_exit("standard input was closed before an answer was given");
+        }
 
         // trim input from left and right
         trim_string_in_place(result);
@@ -59,6 +68,17 @@ std::string prompt_user_input(const std::string& prompt, const std::string& defa
 
 bool prompt_user_boolean(const std::string& prompt) {
     static constexpr std::string default_value_string = "Y/N";
+    switch (options::the().prompts()) {
+        case prompt_policy::interactive:
+            break;
+        case prompt_policy::non_interactive:
+            print_fatal_and_exit(std::format("cannot ask for confirmation in non-interactive mode - {} (use --yes to "
+                                             "answer all confirmations with yes)",
+                                             prompt));
+        case prompt_policy::assume_yes:
+            print_info(std::format("{} - yes (assumed because of --yes)", prompt));
+            return true;
+    }
     while (true) {
         auto result = prompt_user_input(prompt, default_value_string, true);
         if (result == default_value_string) {
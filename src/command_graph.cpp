@@ -0,0 +1,299 @@
+#include <lppm/command_graph.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <lppm/cli.h>
+#include <lppm/common.h>
+#include <lppm/os.h>
+#include <lppm/profiler.h>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace lppm {
+
+using clock = std::chrono::steady_clock;
+
+// how often commands are checked for having exited, where the system offers no pidfd to wait for that
+static constexpr int exit_check_interval_milliseconds = 50;
+
+// reason for which a command was terminated by lppm
+enum class termination_cause {
+    none,
+    timed_out,
+    template_timed_out,
+    stopped,
+};
+
+struct running_command {
+public:
+    usz index;
+    child_process process;
+    std::string pending_output {};
+    std::optional<clock::time_point> deadline {};
+    termination_cause cause { termination_cause::none };
+    std::optional<clock::time_point> kill_deadline {};
+};
+
+static void print_command_line(usz index, std::string_view line) {
+    print_unformatted_line(std::format(STYLE_BLUE "[{}]" STYLE_RESET " {}", index, line));
+}
+
+// prints all complete lines of the output, keeping the unfinished one for later
+static void print_command_output(running_command& running, bool flush_everything) {
+    std::string_view output { running.pending_output };
+    usz line_start = 0;
+    for (usz line_end = 0; (line_end = output.find('\n', line_start)) != std::string_view::npos;
+         line_start = line_end + 1)
+        print_command_line(running.index, output.substr(line_start, line_end - line_start));
+    if (flush_everything && line_start != output.size()) {
+        print_command_line(running.index, output.substr(line_start));
+        line_start = output.size();
+    }
+    running.pending_output.erase(0, line_start);
+}
+
+// reads what the output pipe holds right now (at most max_reads times), without blocking - the pipe is closed once its
+// end is reached
+static void read_command_output(running_command& running, usz max_reads) {
+    for (usz reads = 0; running.process.output_fd >= 0 && reads < max_reads; reads++) {
+        pollfd output_poll { running.process.output_fd, POLLIN, 0 };
+        if (poll(&output_poll, 1, 0) <= 0 || output_poll.revents == 0)
+            return;
+
+        c8 buffer[64 * 1024];
+        auto read_size = read(running.process.output_fd, buffer, sizeof(buffer));
+        if (read_size < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (read_size > 0) {
+            running.pending_output.append(buffer, static_cast<usz>(read_size));
+            print_command_output(running, false);
+            continue;
+        }
+        print_command_output(running, true);
+        close(running.process.output_fd);
+        running.process.output_fd = -1;
+    }
+}
+
+// once the command is reaped, the rest of its output is printed - whatever it started may keep the pipe open (and keep
+// writing into it), so its end is not waited for and only what fits into the largest pipe buffer is read
+static void close_command_output(running_command& running) {
+    read_command_output(running, 16);
+    print_command_output(running, true);
+    if (running.process.output_fd >= 0) {
+        close(running.process.output_fd);
+        running.process.output_fd = -1;
+    }
+}
+
+static std::string format_seconds(std::chrono::nanoseconds duration) {
+    return std::format("{:.2f}s", std::chrono::duration<double>(duration).count());
+}
+
+// prints how the command finished and how long it took
+static void print_command_status(const running_command& running, const command_result& result) {
+    std::string status {};
+    switch (running.cause) {
+        case termination_cause::timed_out:
+            status = std::format(STYLE_RED "timed out after {}" STYLE_RESET, format_seconds(result.wall_time));
+            break;
+        case termination_cause::template_timed_out:
+            status = std::format(STYLE_RED "terminated after {}, because the template timed out" STYLE_RESET,
+                                 format_seconds(result.wall_time));
+            break;
+        case termination_cause::stopped:
+            status = std::format(STYLE_YELLOW "terminated after {}, because another command failed" STYLE_RESET,
+                                 format_seconds(result.wall_time));
+            break;
+        case termination_cause::none:
+            if (result.signal.has_value())
+                status = std::format(STYLE_RED "killed by signal {} ({}) after {}" STYLE_RESET, result.signal.value(),
+                                     strsignal(result.signal.value()), format_seconds(result.wall_time));
+            else if (!result.succeeded())
+                status = std::format(STYLE_RED "failed with exit code {} after {}" STYLE_RESET, result.exit_code,
+                                     format_seconds(result.wall_time));
+            else
+                status = std::format(STYLE_GREEN "finished in {}" STYLE_RESET, format_seconds(result.wall_time));
+            break;
+    }
+    print_command_line(running.index, status);
+}
+
+static std::string describe_failure(const std::string& command, const command_result& result) {
+    if (result.signal.has_value()) {
+        return std::format("executed command `{}` was killed by signal {} ({})", command, result.signal.value(),
+                           strsignal(result.signal.value()));
+    }
+    return std::format("executed command `{}` returned non-zero ({}) exit code", command, result.exit_code);
+}
+
+std::optional<std::string> run_command_graph(const std::vector<graph_command>& commands, usz max_parallel,
+                                             std::optional<u64> timeout_seconds) {
+    max_parallel = std::max<usz>(max_parallel, 1);
+
+    // count unfinished dependencies of every command, commands without any are ready right away
+    std::vector<usz> unfinished_dependencies(commands.size(), 0);
+    std::vector<std::vector<usz>> dependents(commands.size());
+    std::deque<usz> ready_commands {};
+    for (usz index = 0; index < commands.size(); index++) {
+        for (auto dependency : commands[index].dependencies) {
+            if (dependency >= index)
+                print_internal_error_and_exit(std::format("command {} depends on command {}", index, dependency));
+            dependents[dependency].push_back(index);
+        }
+        unfinished_dependencies[index] = commands[index].dependencies.size();
+        if (unfinished_dependencies[index] == 0)
+            ready_commands.push_back(index);
+    }
+
+    // commands which can only run one at a time share the terminal with lppm, like they did when they were run through
+    // std::system, so they may be interactive - output of commands running in parallel is captured and prefixed instead
+    bool is_chain = true;
+    for (usz index = 1; index < commands.size(); index++) {
+        if (std::ranges::find(commands[index].dependencies, index - 1) == commands[index].dependencies.end())
+            is_chain = false;
+    }
+    auto output = is_chain || max_parallel == 1 ? command_output::inherited : command_output::captured;
+
+    std::optional<std::string> error {};
+    std::vector<running_command> running_commands {};
+    // deadlines that are not set (or that were already enforced) are at the end of time
+    auto template_deadline = clock::time_point::max();
+    if (timeout_seconds.has_value())
+        template_deadline = clock::now() + std::chrono::seconds { timeout_seconds.value() };
+
+    // terminates a running command, it gets killed if it does not finish within the grace period
+    auto terminate = [&](running_command& running, termination_cause cause) {
+        if (running.cause != termination_cause::none)
+            return;
+        running.cause = cause;
+        running.kill_deadline = clock::now() + termination_grace_period;
+        os::terminate_child(running.process);
+    };
+
+    while (true) {
+        // start as many ready commands as allowed, unless something has failed already
+        while (!error.has_value() && running_commands.size() < max_parallel && !ready_commands.empty()) {
+            usz index = ready_commands.front();
+            ready_commands.pop_front();
+            print_unformatted_line(std::format(STYLE_BLUE "[{}]" STYLE_RESET " " STYLE_YELLOW "$ {}" STYLE_RESET,
+                                               index, commands[index].command));
+
+            auto& command = commands[index];
+            auto started = os::start_command(command.command, command.working_directory, output, command.limits);
+            if (std::holds_alternative<std::string>(started)) {
+                error = std::get<std::string>(started);
+                for (auto& running : running_commands)
+                    terminate(running, termination_cause::stopped);
+                break;
+            }
+            running_commands.push_back({ index, std::get<child_process>(started) });
+            if (auto timeout = commands[index].timeout_seconds; timeout.has_value())
+                running_commands.back().deadline = clock::now() + std::chrono::seconds { timeout.value() };
+        }
+        if (running_commands.empty())
+            break;
+
+        // enforce the deadlines - timed out commands are terminated first and killed after the grace period
+        auto now = clock::now();
+        auto next_deadline = template_deadline;
+        if (now >= template_deadline) {
+            template_deadline = next_deadline = clock::time_point::max();
+            if (!error.has_value())
+                error = std::format("template commands did not finish within {} second(s)", timeout_seconds.value());
+            for (auto& running : running_commands)
+                terminate(running, termination_cause::template_timed_out);
+        }
+        for (auto& running : running_commands) {
+            if (running.cause == termination_cause::none && running.deadline.has_value() &&
+                now >= running.deadline.value()) {
+                terminate(running, termination_cause::timed_out);
+                if (!error.has_value()) {
+                    auto& command = commands[running.index];
+                    error = std::format("executed command `{}` did not finish within {} second(s)", command.command,
+                                        command.timeout_seconds.value());
+                }
+                for (auto& other : running_commands)
+                    terminate(other, termination_cause::stopped);
+            }
+            if (running.kill_deadline.has_value() && now >= running.kill_deadline.value()) {
+                running.kill_deadline.reset();
+                os::kill_child(running.process);
+            }
+
+            if (running.cause == termination_cause::none && running.deadline.has_value())
+                next_deadline = std::min(next_deadline, running.deadline.value());
+            if (running.kill_deadline.has_value())
+                next_deadline = std::min(next_deadline, running.kill_deadline.value());
+        }
+
+        // wait for output or exit of any of the running commands, or for the nearest deadline - commands without
+        // a pidfd are checked periodically, as nothing wakes the poll up when they exit
+        int poll_timeout = -1;
+        if (next_deadline != clock::time_point::max()) {
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(next_deadline - clock::now());
+            poll_timeout = static_cast<int>(std::clamp<i64>(remaining.count(), 0, 24 * 60 * 60 * 1000));
+        }
+        std::vector<pollfd> poll_fds {};
+        for (auto& running : running_commands) {
+            if (running.process.output_fd >= 0)
+                poll_fds.push_back({ running.process.output_fd, POLLIN, 0 });
+            if (running.process.pid_fd >= 0)
+                poll_fds.push_back({ running.process.pid_fd, POLLIN, 0 });
+            else if (poll_timeout < 0 || poll_timeout > exit_check_interval_milliseconds)
+                poll_timeout = exit_check_interval_milliseconds;
+        }
+        if (poll(poll_fds.data(), poll_fds.size(), poll_timeout) < 0) {
+            if (errno == EINTR)
+                continue;
+            print_internal_error_and_exit(
+                std::format("could not wait for output of commands - {}", std::strerror(errno)));
+        }
+
+        for (usz position = running_commands.size(); position-- > 0;) {
+            // print the output line by line - its end only means the command (and everything it started) closed it
+            auto& running = running_commands[position];
+            read_command_output(running, 1);
+
+            // the command is finished once it is reaped, deadlines are enforced until then
+            auto waited = os::try_wait_for_child(running.process);
+            if (!waited.has_value())
+                continue;
+            auto& result = waited.value();
+            close_command_output(running);
+            print_command_status(running, result);
+            profiler::the().record_command(running.index, commands[running.index].command, running.process.start_time,
+                                           result.wall_time, result.exit_code);
+
+            // the first failure stops everything, otherwise the dependents of the command may become ready
+            if (!result.succeeded() && !error.has_value()) {
+                error = describe_failure(commands[running.index].command, result);
+                for (auto& other : running_commands) {
+                    if (&other != &running)
+                        terminate(other, termination_cause::stopped);
+                }
+            } else if (result.succeeded() && running.cause == termination_cause::none) {
+                for (auto dependent : dependents[running.index]) {
+                    if (--unfinished_dependencies[dependent] == 0)
+                        ready_commands.push_back(dependent);
+                }
+            }
+            running_commands.erase(running_commands.begin() + position);
+        }
+    }
+
+    return error;
+}
+
+} // namespace lppm
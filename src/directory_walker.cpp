@@ -0,0 +1,192 @@
+#include <lppm/directory_walker.h>
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <lppm/common.h>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace lppm {
+
+directory_walker::directory_walker(const std::string& root_path, const visitor& visit)
+    : m_visit(visit), m_path(root_path) {
+    // relative paths start right after the root path and its separator
+    if (!m_path.ends_with('/'))
+        m_path += '/';
+    m_relative_offset = m_path.size();
+}
+
+#if defined(__linux__)
+// records returned by getdents64 have the layout of dirent64, with names only as long as they need to be
+static i64 read_directory_records(int directory_fd, void* buffer, usz size) {
+    return static_cast<i64>(syscall(SYS_getdents64, directory_fd, buffer, size));
+}
+
+std::optional<std::string> directory_walker::walk(const std::string& root_path, const visitor& visit) {
+    int root_fd = open(root_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0)
+        return std::format("could not open directory `{}` - {}", root_path, std::strerror(errno));
+
+    directory_walker walker { root_path, visit };
+    walker.m_buffer.resize(read_buffer_size / sizeof(u64));
+    auto result = walker.walk_directory(root_fd);
+    close(root_fd);
+    return result;
+}
+
+std::optional<std::string> directory_walker::walk_directory(int directory_fd) {
+    // all names are read before any of them is visited, so the buffer can be reused by subdirectories
+    struct record {
+    public:
+        std::string name;
+        u8 type;
+    };
+    std::vector<record> records {};
+    while (true) {
+        auto read_size = read_directory_records(directory_fd, m_buffer.data(), m_buffer.size() * sizeof(u64));
+        if (read_size < 0)
+            return std::format("could not read directory `{}` - {}", m_path, std::strerror(errno));
+        if (read_size == 0)
+            break;
+        for (i64 offset = 0; offset < read_size;) {
+            auto* current = reinterpret_cast<const dirent64*>(reinterpret_cast<const c8*>(m_buffer.data()) + offset);
+            offset += current->d_reclen;
+            std::string_view name { current->d_name };
+            if (name != "." && name != "..")
+                records.push_back({ std::string { name }, current->d_type });
+        }
+    }
+
+    usz directory_path_size = m_path.size();
+    for (auto& current : records) {
+        m_path.resize(directory_path_size);
+        if (!m_path.ends_with('/'))
+            m_path += '/';
+        usz name_offset = m_path.size();
+        m_path += current.name;
+
+        // only entries of unknown type and symbolic links are stat-ed - like with directory_entry::is_directory,
+        // entries which cannot be stat-ed for other reasons than not existing are reported as directories
+        bool is_directory = current.type == DT_DIR;
+        bool can_be_entered = is_directory;
+        bool is_symbolic_link = current.type == DT_LNK;
+        if (current.type == DT_UNKNOWN || current.type == DT_LNK) {
+            struct stat entry_stat {};
+            if (current.type == DT_UNKNOWN &&
+                fstatat(directory_fd, current.name.c_str(), &entry_stat, AT_SYMLINK_NOFOLLOW) == 0 &&
+                !S_ISLNK(entry_stat.st_mode)) {
+                is_directory = can_be_entered = S_ISDIR(entry_stat.st_mode);
+            } else {
+                // entries which could not be told apart from symbolic links are treated like them
+                is_symbolic_link = true;
+                if (fstatat(directory_fd, current.name.c_str(), &entry_stat, 0) == 0)
+                    is_directory = S_ISDIR(entry_stat.st_mode);
+                else
+                    is_directory = errno != ENOENT;
+            }
+        }
+
+        auto result =
+            m_visit({ m_path, m_relative_offset, name_offset, directory_fd, is_directory, is_symbolic_link });
+        if (result == action::stop) {
+            m_stopped = true;
+            return {};
+        }
+        if (!can_be_entered || result == action::skip)
+            continue;
+
+        int child_fd = openat(directory_fd, current.name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+        if (child_fd < 0)
+            return std::format("could not open directory `{}` - {}", m_path, std::strerror(errno));
+        auto error = walk_directory(child_fd);
+        close(child_fd);
+        if (error.has_value() || m_stopped)
+            return error;
+    }
+    return {};
+}
+
+std::optional<directory_walker::file_stamp> directory_walker::stamp_of(const entry& visited) {
+    // the name is at the end of the path, so it is null-terminated
+    struct stat file_stat {};
+    if (fstatat(visited.directory_fd, visited.name().data(), &file_stat, 0) != 0)
+        return {};
+
+    // the time is converted the same way std::filesystem::last_write_time does it, so both can be compared
+    std::chrono::sys_time<std::chrono::nanoseconds> time { std::chrono::seconds { file_stat.st_mtim.tv_sec } +
+                                                           std::chrono::nanoseconds { file_stat.st_mtim.tv_nsec } };
+    return file_stamp { static_cast<u64>(file_stat.st_size),
+                        std::filesystem::file_time_type::clock::from_sys(time).time_since_epoch().count() };
+}
+#else
+std::optional<std::string> directory_walker::walk(const std::string& root_path, const visitor& visit) {
+    directory_walker walker { root_path, visit };
+    return walker.walk_directory(-1);
+}
+
+std::optional<std::string> directory_walker::walk_directory(int) {
+    std::vector<std::filesystem::directory_entry> entries {};
+    std::error_code code {};
+    for (std::filesystem::directory_iterator iterator { m_path, code }, end {}; !code && iterator != end;
+         iterator.increment(code))
+        entries.push_back(*iterator);
+    if (code)
+        return std::format("could not read directory `{}` - {}", m_path, code.message());
+
+    usz directory_path_size = m_path.size();
+    for (auto& current : entries) {
+        m_path.resize(directory_path_size);
+        if (!m_path.ends_with('/'))
+            m_path += '/';
+        usz name_offset = m_path.size();
+        m_path += current.path().filename().string();
+
+        std::error_code type_code {};
+        bool is_directory = current.is_directory(type_code) || type_code;
+        bool can_be_entered = is_directory && !current.is_symlink(type_code) && !type_code;
+
+        bool is_symbolic_link = current.is_symlink(type_code) && !type_code;
+        auto result = m_visit({ m_path, m_relative_offset, name_offset, -1, is_directory, is_symbolic_link });
+        if (result == action::stop) {
+            m_stopped = true;
+            return {};
+        }
+        if (!can_be_entered || result == action::skip)
+            continue;
+
+        auto error = walk_directory(-1);
+        if (error.has_value() || m_stopped)
+            return error;
+    }
+    return {};
+}
+
+std::optional<directory_walker::file_stamp> directory_walker::stamp_of(const entry& visited) {
+    std::error_code code {};
+    std::filesystem::path path { visited.path };
+    u64 size = std::filesystem::file_size(path, code);
+    if (code)
+        return {};
+    i64 modification_time = std::filesystem::last_write_time(path, code).time_since_epoch().count();
+    if (code)
+        return {};
+    return file_stamp { size, modification_time };
+}
+#endif
+
+} // namespace lppm
@@ -0,0 +1,165 @@
+#include <lppm/file_contents.h>
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/os.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <ios>
+#endif
+
+namespace lppm {
+
+// pool of buffers used for small files, so reading many of them does not allocate over and over again
+class buffer_pool {
+public:
+    static buffer_pool& the() {
+        static buffer_pool pool {};
+        return pool;
+    }
+
+    std::vector<c8> acquire() {
+        std::lock_guard lock { m_mutex };
+        if (m_buffers.empty())
+            return {};
+        auto buffer = std::move(m_buffers.back());
+        m_buffers.pop_back();
+        return buffer;
+    }
+
+    void release(std::vector<c8> buffer) {
+        if (buffer.capacity() == 0 || buffer.capacity() > file_contents::mapping_threshold)
+            return;
+        std::lock_guard lock { m_mutex };
+        if (m_buffers.size() < max_pooled_buffers)
+            m_buffers.push_back(std::move(buffer));
+    }
+
+private:
+    static constexpr usz max_pooled_buffers = 256;
+
+    std::mutex m_mutex {};
+    std::vector<std::vector<c8>> m_buffers {};
+};
+
+std::variant<std::string, file_contents> file_contents::read(const std::string& path, bool always_map) {
+    return read(entry_location { path }, always_map);
+}
+
+#if defined(__linux__)
+std::variant<std::string, file_contents> file_contents::read(const entry_location& location, bool always_map) {
+    auto& path = location.path;
+    int fd = os::open_file(location);
+    if (fd < 0)
+        return std::format("could not open file `{}` for reading - {}", path, std::strerror(errno));
+
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return std::format("could not read attributes of file `{}` - {}", path, std::strerror(errno));
+    }
+    usz size = static_cast<usz>(file_stat.st_size);
+
+    // map large files, populating the page tables up front and letting the kernel read ahead aggressively
+    file_contents result {};
+    if (size >= mapping_threshold || (always_map && size != 0)) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+            return std::format("could not map file `{}` - {}", path, std::strerror(errno));
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        result.m_mapping = mapping;
+        result.m_mapping_size = size;
+        return result;
+    }
+
+    // read small files with a single pread (unless it is interrupted or the file changes in the meantime)
+    result.m_buffer = buffer_pool::the().acquire();
+    result.m_buffer.resize(size);
+    usz read_size = 0;
+    while (read_size < size) {
+        ssize_t current = pread(fd, result.m_buffer.data() + read_size, size - read_size, read_size);
+        if (current < 0 && errno == EINTR)
+            continue;
+        if (current < 0) {
+            close(fd);
+            return std::format("could not read contents of file `{}` - {}", path, std::strerror(errno));
+        }
+        if (current == 0)
+            break;
+        read_size += current;
+    }
+    result.m_buffer.resize(read_size);
+    close(fd);
+    return result;
+}
+#else
+std::variant<std::string, file_contents> file_contents::read(const entry_location& location, bool) {
+    auto& path = location.path;
+    std::ifstream file { path, std::ios::binary | std::ios::ate };
+    if (!file)
+        return std::format("could not open file `{}` for reading", path);
+
+    file_contents result {};
+    result.m_buffer = buffer_pool::the().acquire();
+    result.m_buffer.resize(static_cast<usz>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(result.m_buffer.data(), static_cast<std::streamsize>(result.m_buffer.size())))
+        return std::format("could not read contents of file `{}`", path);
+    return result;
+}
+#endif
+
+file_contents::file_contents(file_contents&& other) noexcept
+    : m_mapping(std::exchange(other.m_mapping, nullptr)), m_mapping_size(std::exchange(other.m_mapping_size, 0)),
+      m_buffer(std::move(other.m_buffer)) {}
+
+file_contents& file_contents::operator=(file_contents&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+        m_mapping_size = std::exchange(other.m_mapping_size, 0);
+        m_buffer = std::move(other.m_buffer);
+    }
+    return *this;
+}
+
+file_contents::~file_contents() { release(); }
+
+std::string_view file_contents::view() const {
+    if (m_mapping != nullptr)
+        return { static_cast<const c8*>(m_mapping), m_mapping_size };
+    return { m_buffer.data(), m_buffer.size() };
+}
+
+usz file_contents::size() const { return m_mapping != nullptr ? m_mapping_size : m_buffer.size(); }
+
+bool file_contents::is_mapped() const { return m_mapping != nullptr; }
+
+void file_contents::release() {
+#if defined(__linux__)
+    if (m_mapping != nullptr)
+        munmap(m_mapping, m_mapping_size);
+#endif
+    m_mapping = nullptr;
+    m_mapping_size = 0;
+    buffer_pool::the().release(std::move(m_buffer));
+    m_buffer = {};
+}
+
+} // namespace lppm
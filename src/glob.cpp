@@ -0,0 +1,96 @@
+#include <lppm/glob.h>
+
+#include <string_view>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+// matches a single character against a character class starting right after "[", advancing the pattern past it -
+// returns false if the class is not terminated, in which case "[" is matched literally
+static bool match_character_class(std::string_view& pattern, c8 character, bool& matched) {
+    usz index = 0;
+    bool negated = index < pattern.size() && (pattern[index] == '!' || pattern[index] == '^');
+    if (negated)
+        index++;
+
+    matched = false;
+    for (bool first = true; index < pattern.size() && (first || pattern[index] != ']'); first = false) {
+        c8 low = pattern[index];
+        if (low == '\\' && index + 1 < pattern.size())
+            low = pattern[++index];
+        c8 high = low;
+        if (index + 2 < pattern.size() && pattern[index + 1] == '-' && pattern[index + 2] != ']') {
+            high = pattern[index + 2];
+            index += 2;
+        }
+        if (character >= low && character <= high)
+            matched = true;
+        index++;
+    }
+    if (index >= pattern.size())
+        return false;
+
+    matched = matched != negated;
+    pattern.remove_prefix(index + 1);
+    return true;
+}
+
+static bool match_from(std::string_view pattern, std::string_view path, bool at_component_start) {
+    while (!pattern.empty()) {
+        // "**" as a whole component matches any number of components
+        if (at_component_start && pattern.starts_with("**") && (pattern.size() == 2 || pattern[2] == '/')) {
+            if (pattern.size() == 2)
+                return true;
+            auto rest = pattern.substr(3);
+            if (match_from(rest, path, true))
+                return true;
+            for (usz index = 0; index < path.size(); index++) {
+                if (path[index] == '/' && match_from(rest, path.substr(index + 1), true))
+                    return true;
+            }
+            return false;
+        }
+
+        // "*" matches any sequence of characters, up to the end of the component
+        c8 current = pattern.front();
+        if (current == '*') {
+            while (!pattern.empty() && pattern.front() == '*')
+                pattern.remove_prefix(1);
+            for (usz index = 0;; index++) {
+                if (match_from(pattern, path.substr(index), false))
+                    return true;
+                if (index >= path.size() || path[index] == '/')
+                    return false;
+            }
+        }
+
+        if (path.empty())
+            return false;
+        c8 character = path.front();
+        pattern.remove_prefix(1);
+        if (current == '?') {
+            if (character == '/')
+                return false;
+        } else if (bool matched = false; current == '[' && match_character_class(pattern, character, matched)) {
+            if (!matched || character == '/')
+                return false;
+        } else {
+            if (current == '\\' && !pattern.empty()) {
+                current = pattern.front();
+                pattern.remove_prefix(1);
+            }
+            if (current != character)
+                return false;
+        }
+
+        path.remove_prefix(1);
+        at_component_start = character == '/';
+    }
+
+    return path.empty();
+}
+
+bool match_glob(std::string_view pattern, std::string_view path) { return match_from(pattern, path, true); }
+
+} // namespace lppm
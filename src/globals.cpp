@@ -4,6 +4,13 @@
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include <lppm/cli.h>
 #include <lppm/common.h>
@@ -12,7 +19,26 @@
 
 namespace lppm {
 
-globals::globals() {
+// splits a line in the <key>:<value> form, both parts are trimmed
+static std::optional<globals::entry> split_entry(std::string_view line) {
+    auto colon_position = line.find(':');
+    if (colon_position == std::string_view::npos)
+        return {};
+    return globals::entry { std::string { trim_string_view(line.substr(0, colon_position)) },
+                            std::string { trim_string_view(line.substr(colon_position + 1)) } };
+}
+
+globals::globals() { load_globals_file(); }
+
+void globals::reload() {
+    m_values.clear();
+    m_was_file_malformed_on_read = false;
+    m_pending_records.clear();
+    m_journal_record_count = 0;
+    load_globals_file();
+}
+
+void globals::load_globals_file() {
     // read the globals file (if any exists)
     std::ifstream globals_file { get_globals_file_path() };
     if (globals_file) {
@@ -25,11 +51,9 @@ globals::globals() {
             if (line.empty() || line[0] == '#')
                 continue;
 
-            // extract entry name from the read line
-            std::string entry_name { line };
-            auto colon_iterator = std::find_if(entry_name.begin(), entry_name.end(), [](c8 c) { return c == ':'; });
-            usz colon_position = colon_iterator - entry_name.begin();
-            if (colon_iterator == entry_name.end()) {
+            // extract entry name and value from the read line
+            auto maybe_entry = split_entry(line);
+            if (!maybe_entry.has_value()) {
                 print_warning(std::format(
                     "malformed replacement variable entry in globals config file (path: `{}`) - `{}` - was the "
                     "file modified by hand?",
@@ -37,12 +61,7 @@ globals::globals() {
                 m_was_file_malformed_on_read = true;
                 continue;
             }
-            entry_name.erase(colon_iterator, entry_name.end());
-            trim_string_in_place(entry_name);
-
-            // everything after the colon is treated as global value (trimmed)
-            std::string value { line.begin() + colon_position + 1, line.end() };
-            trim_string_in_place(value);
+            auto& [entry_name, value] = maybe_entry.value();
 
             // insert a value into known values map
             if (m_values.contains(entry_name)) {
@@ -56,13 +75,46 @@ globals::globals() {
             }
             m_values[entry_name] = value;
         }
-    } else {
+    } else if (std::error_code code; !std::filesystem::exists(get_journal_file_path(), code)) {
         print_warning(std::format(
             "globals config file (path: `{}`) could not be read (missing or permissions error) - consider "
             "running `lppm globals init` command to initialize user data or check your configuration if you "
             "think this should not be the case",
             get_globals_file_path()));
     }
+
+    // apply changes made since the file was last written
+    load_journal_file();
+}
+
+void globals::load_journal_file() {
+    std::ifstream journal_file { get_journal_file_path() };
+    if (!journal_file)
+        return;
+
+    // records are applied in order - replaying them again over a compacted file gives the same result, so the
+    // journal does not have to be removed atomically with the compaction
+    for (std::string line {}; std::getline(journal_file, line);) {
+        trim_string_left_in_place(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::optional<entry> maybe_entry {};
+        if (line.starts_with("set "))
+            maybe_entry = split_entry(std::string_view { line }.substr(4));
+        if (maybe_entry.has_value()) {
+            m_values.insert_or_assign(std::move(maybe_entry->first), std::move(maybe_entry->second));
+        } else if (line.starts_with("unset ")) {
+            m_values.erase(trim_string(line.substr(6)));
+        } else {
+            print_warning(std::format("malformed record in globals journal file (path: `{}`) - `{}` - was the file "
+                                      "modified by hand?",
+                                      get_journal_file_path(), line));
+            m_was_file_malformed_on_read = true;
+            continue;
+        }
+        m_journal_record_count++;
+    }
 }
 
 globals& globals::the() {
@@ -73,6 +125,8 @@ globals& globals::the() {
 
 std::map<std::string, std::string> globals::mappings() const { return m_values; }
 
+const std::map<std::string, std::string>& globals::values() const { return m_values; }
+
 std::vector<std::string> globals::key_set() const {
     std::vector<std::string> keys {};
     for (auto& [key, _] : m_values)
@@ -105,10 +159,11 @@ void globals::set_value(const std::string& key, const std::string& value, bool s
 
     // set value
     m_values[key] = trim_string(value);
+    m_pending_records.push_back(std::format("set {}:{}", key, m_values[key]));
 
     // save file if necessary
     if (should_save_file)
-        save_globals_file();
+        save_changes();
 }
 
 void globals::remove_value(const std::string& key, bool should_save_file) {
@@ -118,11 +173,58 @@ void globals::remove_value(const std::string& key, bool should_save_file) {
 
     // remove entry and save if necessary
     m_values.erase(key);
+    m_pending_records.push_back(std::format("unset {}", key));
     if (should_save_file)
-        save_globals_file();
+        save_changes();
+}
+
+void globals::import_values(const std::vector<entry>& entries) {
+    begin_batch();
+    for (auto& [key, value] : entries) {
+        m_values.insert_or_assign(key, trim_string(value));
+        m_pending_records.push_back(std::format("set {}:{}", key, m_values[key]));
+    }
+    commit_batch();
+}
+
+void globals::begin_batch() { m_batch_depth++; }
+
+void globals::commit_batch() {
+    if (m_batch_depth == 0)
+        print_internal_error_and_exit("globals batch committed without being started");
+    if (--m_batch_depth == 0)
+        save_changes();
+}
+
+std::variant<std::string, std::vector<globals::entry>> globals::read_entries_file(const std::string& path) {
+    std::ifstream file { path };
+    if (!file)
+        return std::format("cannot open file `{}` for reading", path);
+
+    std::vector<entry> result {};
+    std::map<std::string, usz> line_of_key {};
+    usz line_number = 0;
+    for (std::string line {}; std::getline(file, line);) {
+        line_number++;
+        trim_string_left_in_place(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        auto maybe_entry = split_entry(line);
+        if (!maybe_entry.has_value() || maybe_entry->first.empty())
+            return std::format("malformed entry at line {} of file `{}` - expected <key>:<value>", line_number, path);
+        if (auto [iterator, inserted] = line_of_key.try_emplace(maybe_entry->first, line_number); !inserted) {
+            return std::format("entry `{}` at line {} of file `{}` was already given at line {}", maybe_entry->first,
+                               line_number, path, iterator->second);
+        }
+        result.push_back(std::move(maybe_entry.value()));
+    }
+    if (file.bad())
+        return std::format("cannot read file `{}`", path);
+    return result;
 }
 
-void globals::save_globals_file() const {
+void globals::confirm_saving_malformed_file() const {
     // check if file was malformed on read
     if (m_was_file_malformed_on_read) {
         print_warning("globals config file is about to be modified, but it was malformed on read");
@@ -134,30 +236,88 @@ void globals::save_globals_file() const {
         // do not prompt this on subsequent writes
         m_was_file_malformed_on_read = false;
     }
+}
+
+void globals::save_changes() {
+    if (m_batch_depth != 0 || m_pending_records.empty())
+        return;
+    confirm_saving_malformed_file();
+
+    // once the journal outgrows the values themselves, write all values out again instead
+    if (m_journal_record_count + m_pending_records.size() > std::max(min_compaction_threshold, m_values.size())) {
+        save_globals_file();
+        return;
+    }
 
     // ensure config directory exists
     os::ensure_directory_exists(os::get_lppm_config_directory());
 
-    // open file for writing
-    std::ofstream globals_file { get_globals_file_path() };
-    if (!globals_file) {
+    // append all pending records with a single write
+    std::string records {};
+    if (m_journal_record_count == 0)
+        records += "# this file contains changes of global replacement variables made since globals.conf was written\n";
+    for (auto& record : m_pending_records) {
+        records += record;
+        records += '\n';
+    }
+    std::ofstream journal_file { get_journal_file_path(), std::ios::binary | std::ios::app };
+    if (!journal_file || !journal_file.write(records.data(), static_cast<std::streamsize>(records.size())) ||
+        !journal_file.flush()) {
         print_fatal_and_exit(
-            std::format("cannot open globals config file for writing (path: `{}`)", get_globals_file_path()));
+            std::format("cannot append to globals journal file (path: `{}`)", get_journal_file_path()));
     }
+    m_journal_record_count += m_pending_records.size();
+    m_pending_records.clear();
+}
 
-    // write a header
-    globals_file << "# this file contains global replacement variable definitions\n";
-    globals_file << "# each entry has a form <key>:<value>\n";
-    globals_file << "# it is strongly encouraged to make all keys UPPERCASE and use llpm commands to manage contents "
-                    "of this file\n\n";
+void globals::save_globals_file() {
+    // ensure config directory exists
+    os::ensure_directory_exists(os::get_lppm_config_directory());
+
+    // write to a temporary file first and rename it, so a partially written file is never read
+    std::string temporary_path = unique_temporary_path(get_globals_file_path());
+    {
+        std::ofstream globals_file { temporary_path, std::ios::binary };
+        if (!globals_file) {
+            print_fatal_and_exit(
+                std::format("cannot open globals config file for writing (path: `{}`)", temporary_path));
+        }
 
-    // write all entries
-    for (auto& [key, value] : m_values)
-        globals_file << std::format("{}:{}\n", key, value);
+        // write a header and all entries
+        std::string contents { "# this file contains global replacement variable definitions\n"
+                               "# each entry has a form <key>:<value>\n"
+                               "# it is strongly encouraged to make all keys UPPERCASE and use llpm commands to "
+                               "manage contents of this file\n\n" };
+        for (auto& [key, value] : m_values)
+            contents += std::format("{}:{}\n", key, value);
+        if (!globals_file.write(contents.data(), static_cast<std::streamsize>(contents.size())) ||
+            !globals_file.flush()) {
+            std::error_code code {};
+            std::filesystem::remove(temporary_path, code);
+            print_fatal_and_exit(std::format("cannot write globals config file (path: `{}`)", temporary_path));
+        }
+    }
+    std::error_code code {};
+    std::filesystem::rename(temporary_path, get_globals_file_path(), code);
+    if (code) {
+        auto message = code.message();
+        std::filesystem::remove(temporary_path, code);
+        print_fatal_and_exit(std::format("cannot replace globals config file (path: `{}`) - {}",
+                                         get_globals_file_path(), message));
+    }
+
+    // all changes are in the file now, so the journal can be dropped
+    std::filesystem::remove(get_journal_file_path(), code);
+    m_journal_record_count = 0;
+    m_pending_records.clear();
 }
 
 std::string globals::get_globals_file_path() {
     return std::filesystem::path { os::get_lppm_config_directory() } / globals_file_name;
 }
 
+std::string globals::get_journal_file_path() {
+    return std::filesystem::path { os::get_lppm_config_directory() } / journal_file_name;
+}
+
 } // namespace lppm
@@ -7,21 +7,119 @@
 #include <fstream>
 #include <iostream>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <system_error>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include <lppm/blob_store.h>
 #include <lppm/cli.h>
 #include <lppm/common.h>
 #include <lppm/globals.h>
+#include <lppm/ignore_matcher.h>
+#include <lppm/instantiator.h>
+#include <lppm/options.h>
 #include <lppm/os.h>
+#include <lppm/project_manifest.h>
 #include <lppm/substitutor.h>
 #include <lppm/template.h>
+#include <lppm/template_index.h>
+#include <lppm/template_pack.h>
+#include <lppm/template_registry.h>
 #include <lppm/utils.h>
+#include <lppm/variable_scope.h>
 
 namespace lppm::handlers {
 
+// describes settings of a command - its dependencies (if it declares them, otherwise it just runs after the previous
+// command) and limits
+static std::string describe_command_settings(const template_info& info, usz index) {
+    auto& settings = info.settings_of(index);
+    std::vector<std::string> descriptions {};
+    if (settings.dependencies.has_value() && settings.dependencies->empty())
+        descriptions.push_back("runs right away");
+    if (settings.dependencies.has_value() && !settings.dependencies->empty()) {
+        std::string description { "after " };
+        for (usz position = 0; position < settings.dependencies->size(); position++)
+            description += std::format("{}{}", position == 0 ? "" : ", ", settings.dependencies.value()[position]);
+        descriptions.push_back(description);
+    }
+    if (settings.timeout_seconds.has_value())
+        descriptions.push_back(std::format("timeout {}s", settings.timeout_seconds.value()));
+    if (settings.limits.cpu_seconds.has_value())
+        descriptions.push_back(std::format("cpu time {}s", settings.limits.cpu_seconds.value()));
+    if (settings.limits.memory_bytes.has_value())
+        descriptions.push_back(std::format("memory {} bytes", settings.limits.memory_bytes.value()));
+    if (settings.directory.has_value())
+        descriptions.push_back(std::format("in directory {}", settings.directory.value()));
+
+    if (descriptions.empty())
+        return {};
+    std::string result { " (" };
+    for (usz position = 0; position < descriptions.size(); position++)
+        result += (position == 0 ? "" : "; ") + descriptions[position];
+    return result + ")";
+}
+
+static void print_path_rules(const template_info& info) {
+    auto& rules = info.path_rules();
+    if (rules.empty()) {
+        print_unformatted_line(std::format(STYLE_BLUE "template does not contain path rules" STYLE_RESET));
+        return;
+    }
+    print_unformatted_line(std::format(STYLE_BLUE "path rules (the last matching one wins): " STYLE_RESET));
+    for (usz index = 0; index < rules.size(); index++)
+        print_unformatted_line(std::format(" {} - {} " STYLE_YELLOW "{}" STYLE_RESET, index,
+                                           path_action_name(rules[index].action), rules[index].pattern));
+}
+
+static void print_default_values(const template_info& info) {
+    auto& defaults = info.default_values();
+    if (defaults.empty()) {
+        print_unformatted_line(std::format(STYLE_BLUE "template does not declare default values" STYLE_RESET));
+        return;
+    }
+    print_unformatted_line(std::format(STYLE_BLUE "default values of variables: " STYLE_RESET));
+    for (auto& [name, value] : defaults)
+        print_unformatted_line(std::format(" {} - " STYLE_YELLOW "{}" STYLE_RESET, name, value));
+}
+
+// counts files of the template, without entering ignored directories
+static usz count_template_files(const project_template& the_template) {
+    usz file_count = 0;
+    if (the_template.is_packed()) {
+        for (auto& entry : the_template.pack()->entries()) {
+            if (entry.type == template_pack::entry_type::file &&
+                !template_index::is_template_metadata_file(std::filesystem::path { entry.path }.filename()))
+                file_count++;
+        }
+        return file_count;
+    }
+
+    auto& template_path = the_template.base_directory();
+    auto ignore = ignore_matcher::load(template_path);
+    std::error_code code {};
+    for (std::filesystem::recursive_directory_iterator iterator { template_path, code }, end {};
+         !code && iterator != end; iterator.increment(code)) {
+        auto& directory_entry = *iterator;
+        std::error_code type_code {};
+        bool is_directory = directory_entry.is_directory(type_code);
+        if (ignore.is_ignored(directory_entry.path().lexically_relative(template_path).generic_string(),
+                              is_directory)) {
+            if (is_directory)
+                iterator.disable_recursion_pending();
+            continue;
+        }
+        if (std::error_code code; directory_entry.is_regular_file(code) && !code &&
+                                  !template_index::is_template_metadata_file(directory_entry.path().filename())) {
+            file_count++;
+        }
+    }
+    return file_count;
+}
+
 static void print_global_value(const std::string& key, const std::string& value) {
     print_unformatted_line(std::format(STYLE_BLUE "{}" STYLE_RESET ": " STYLE_YELLOW "{}" STYLE_RESET, key, value));
 }
@@ -66,6 +164,38 @@ bool globals_unset_handler(const std::vector<std::string>& arguments) {
     return true;
 }
 
+bool globals_import_handler(const std::vector<std::string>& arguments) {
+    // read all entries before changing anything
+    auto maybe_entries = globals::read_entries_file(arguments[0]);
+    if (std::holds_alternative<std::string>(maybe_entries)) {
+        print_error(std::get<std::string>(maybe_entries));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& entries = std::get<std::vector<globals::entry>>(maybe_entries);
+    if (entries.empty()) {
+        print_info(std::format("file `{}` does not contain any entries", arguments[0]));
+        return true;
+    }
+
+    // ask once for all values that would be overriden, instead of once for every one of them
+    usz overriden_count = 0;
+    for (auto& [key, value] : entries) {
+        auto old_value = globals::the().get_value(key);
+        overriden_count += old_value.has_value() && old_value.value() != trim_string(value) ? 1 : 0;
+    }
+    if (overriden_count != 0) {
+        print_warning(std::format("as the result of this operation, {} global replacement variable(s) will be "
+                                  "overriten with new values",
+                                  overriden_count));
+        if (!prompt_user_boolean("should the variable values be overriten?"))
+            print_fatal_and_exit("user did not consent to overriding global replacement variables");
+    }
+
+    globals::the().import_values(entries);
+    print_info(std::format("successfuly imported {} global replacement variable(s)", entries.size()));
+    return true;
+}
+
 bool globals_list_handler(const std::vector<std::string>& arguments) {
     UNUSED(arguments);
 
@@ -108,7 +238,7 @@ bool globals_init_handler(const std::vector<std::string>& arguments) {
         auto input = prompt_user_input(std::format("enter {} {}", enter_string, globals_string), default_value);
         if (!input.empty()) {
             for (usz index = 0; index < globals_size; index++)
-                globals::the().set_value(globals[index], input, false, index == globals_size - 1);
+                globals::the().set_value(globals[index], input, false);
             return input;
         } else {
             print_warning(std::format("empty {} provided - skipping", empty_string));
@@ -116,12 +246,14 @@ bool globals_init_handler(const std::vector<std::string>& arguments) {
         }
     };
 
-    // ask for data
+    // ask for data - all answers are saved at once
+    globals::the().begin_batch();
     ask_for_input("your name", { "NAME", "AUTHOR" }, "name");
     ask_for_input("your e-mail address", { "EMAIL", "MAIL" }, "e-mail");
     ask_for_input("your website address", { "WEBSITE", "WWW", "SITE" }, "website address");
     ask_for_input("your github profile address", { "GITHUB" }, "github profile address");
     ask_for_input("default license", { "LICENSE" }, "license", "All rights reserved.");
+    globals::the().commit_batch();
 
     return true;
 }
@@ -179,72 +311,129 @@ bool project_init_handler(const std::vector<std::string>& arguments) {
     }
     auto& the_template = std::get<project_template>(maybe_template);
 
-    // create substitutions set and try to substitute all of the template variables
-    auto mappings = globals::the().mappings();
-    mappings.insert_or_assign("PROJECT_NAME", std::filesystem::path { target_path }.filename());
-    for (auto& directory_entry : std::filesystem::recursive_directory_iterator { the_template.base_directory() }) {
-        // do the substitutions in file name if necessary
-        auto relative_path = std::filesystem::relative(directory_entry.path(), the_template.base_directory());
-        std::string unsubstituted_name = target_path / relative_path;
-        std::string path_in_target = do_the_substitutions(unsubstituted_name, mappings);
-
-        // if the entry refers to the directory, create it in target directory
-        if (std::error_code code; directory_entry.is_directory(code) || code) {
-            std::filesystem::create_directories(path_in_target, code);
-            if (code) {
-                print_error(std::format("could not create a directory `{}`", path_in_target));
-                print_fatal_and_exit("could not successfuly perform the operation, aborting...");
-            }
+    // create variable scope and try to substitute all of the template variables
+    variable_scope scope { &the_template.info().default_values() };
+    scope.project_values().insert_or_assign("PROJECT_NAME", std::filesystem::path { target_path }.filename());
+    project_instantiator instantiator { the_template, target_path, scope };
+    auto instantiation_result = instantiator.instantiate(options::the().job_count());
+    if (instantiation_result.has_value()) {
+        print_error(instantiation_result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
 
-            continue;
-        }
+    // execute commands and log info
+    auto result = the_template.info().run_commands_at(target_path, scope, options::the().job_count());
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    print_info(std::format("successfuly created a project at `" STYLE_BLUE "{}" STYLE_RESET
+                           "` from template `" STYLE_BLUE "{}" STYLE_RESET "`",
+                           target_path, template_name));
+    return true;
+}
 
-        // if the entry refers to the .lppm_template file, continue
-        std::string template_file_path = std::filesystem::absolute(
-            std::filesystem::path { the_template.base_directory() } / project_template::template_info_file_name);
-        if (std::filesystem::absolute(directory_entry.path()) == template_file_path)
-            continue;
+bool project_create_many_handler(const std::vector<std::string>& arguments) {
+    // read the list of projects
+    auto maybe_manifest = project_manifest::parse_from_file(arguments[0]);
+    if (std::holds_alternative<std::string>(maybe_manifest)) {
+        print_error(std::get<std::string>(maybe_manifest));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& manifest = std::get<project_manifest>(maybe_manifest);
 
-        // create target directory
-        std::error_code code {};
-        std::string directory_path = std::filesystem::path { path_in_target }.parent_path();
-        if (!std::filesystem::exists(directory_path)) {
-            std::filesystem::create_directories(directory_path, code);
-            if (code) {
-                print_error(std::format("could not create a directory `{}`", path_in_target));
-                print_fatal_and_exit("could not successfuly perform the operation, aborting...");
-            }
+    // ensure that none of the targets exists before creating any of them
+    for (auto& project : manifest.projects()) {
+        if (std::error_code code; std::filesystem::exists(project.target_path, code) && !code) {
+            print_error(std::format("target directory `{}` already exists", project.target_path));
+            print_fatal_and_exit("could not successfuly perform the operation, aborting...");
         }
+    }
 
-        // read file contents, do the substitutions and write a file
-        auto file_contents = read_all_text(directory_entry.path());
-        if (!file_contents.has_value()) {
-            print_error(
-                std::format("could not read contents of file `{}`", static_cast<std::string>(directory_entry.path())));
+    // all projects are rendered concurrently, so no two of them may share a directory - targets are compared after
+    // resolving symbolic links in the existing parts of their paths, and none of them may be inside of another one
+    std::vector<std::string> target_paths {};
+    std::unordered_map<std::string, usz> target_indices {};
+    target_paths.reserve(manifest.projects().size());
+    for (auto& project : manifest.projects()) {
+        std::error_code code {};
+        auto resolved_path = std::filesystem::weakly_canonical(std::filesystem::absolute(project.target_path), code);
+        std::string target_path = resolved_path.lexically_normal();
+        if (code) {
+            print_error(std::format("cannot resolve target directory `{}` - {}", project.target_path, code.message()));
+            print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+        }
+        if (target_path.ends_with(std::filesystem::path::preferred_separator))
+            target_path.pop_back();
+        if (auto [existing, inserted] = target_indices.emplace(target_path, target_paths.size()); !inserted) {
+            print_error(std::format("target directory `{}` is given more than once in the manifest",
+                                    manifest.projects()[existing->second].target_path));
             print_fatal_and_exit("could not successfuly perform the operation, aborting...");
         }
+        target_paths.push_back(std::move(target_path));
+    }
+    for (usz index = 0; index < target_paths.size(); index++) {
+        for (std::filesystem::path parent = std::filesystem::path { target_paths[index] }.parent_path();
+             parent.has_relative_path(); parent = parent.parent_path()) {
+            if (auto outer = target_indices.find(parent.string()); outer != target_indices.end()) {
+                print_error(std::format("target directory `{}` is inside of target directory `{}`",
+                                        manifest.projects()[index].target_path,
+                                        manifest.projects()[outer->second].target_path));
+                print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+            }
+        }
+    }
 
-        // do the substitutions
-        auto after_substitutions = do_the_substitutions(file_contents.value(), mappings);
+    // get template by name - it is loaded (and its files are scanned) only once for all projects
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / manifest.template_name();
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
 
-        // write a substituted file
-        std::ofstream resulting_file { path_in_target };
-        if (!resulting_file) {
-            print_error(std::format("could not create a file `{}` - {}", path_in_target, std::strerror(errno)));
+    // create target directories and variable scopes - variables from the manifest are project variables, so they
+    // override template defaults and globals
+    std::vector<variable_scope> scopes {};
+    std::vector<project_instantiator::target> targets {};
+    scopes.reserve(manifest.projects().size());
+    for (usz index = 0; index < manifest.projects().size(); index++) {
+        auto& project = manifest.projects()[index];
+        auto& target_path = target_paths[index];
+        std::error_code code {};
+        std::filesystem::create_directories(target_path, code);
+        if (code) {
+            print_error(std::format("cannot create target directory `{}`", target_path));
             print_fatal_and_exit("could not successfuly perform the operation, aborting...");
         }
-        resulting_file.write(after_substitutions.c_str(), after_substitutions.size());
+
+        auto& scope = scopes.emplace_back(&the_template.info().default_values());
+        scope.project_values().insert_or_assign("PROJECT_NAME", std::filesystem::path { target_path }.filename());
+        for (auto& [name, value] : project.variables)
+            scope.project_values().insert_or_assign(name, value);
+        targets.push_back({ std::move(target_path), &scope });
     }
 
-    // execute commands and log info
-    auto result = the_template.info().run_commands_at(target_path, mappings);
-    if (result.has_value()) {
-        print_error(result.value());
+    // render all projects at once
+    project_instantiator instantiator { the_template, targets };
+    auto instantiation_result = instantiator.instantiate(options::the().job_count());
+    if (instantiation_result.has_value()) {
+        print_error(instantiation_result.value());
         print_fatal_and_exit("could not successfuly perform the operation, aborting...");
     }
-    print_info(std::format("successfuly created a project at `" STYLE_BLUE "{}" STYLE_RESET
-                           "` from template `" STYLE_BLUE "{}" STYLE_RESET "`",
-                           target_path, template_name));
+
+    // execute commands of every project and log info
+    for (auto& target : targets) {
+        auto result = the_template.info().run_commands_at(target.path, *target.scope, options::the().job_count());
+        if (result.has_value()) {
+            print_error(result.value());
+            print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+        }
+    }
+    print_info(std::format("successfuly created {} projects from template `" STYLE_BLUE "{}" STYLE_RESET "`",
+                           targets.size(), manifest.template_name()));
     return true;
 }
 
@@ -292,8 +481,8 @@ bool template_create_handler(const std::vector<std::string>& arguments) {
 bool template_list_handler(const std::vector<std::string>& arguments) {
     UNUSED(arguments);
 
-    // get a list of available project templates
-    auto templates = project_template::get_all_templates();
+    // get a list of available project templates - the templates themselves are not loaded
+    auto templates = template_registry::list();
     if (templates.size() == 0) {
         print_info("no project templates found");
         return true;
@@ -302,7 +491,7 @@ bool template_list_handler(const std::vector<std::string>& arguments) {
     // print the templates
     for (auto& current : templates) {
         print_unformatted_line(std::format(STYLE_BLUE "{}" STYLE_RESET ": " STYLE_YELLOW "{}" STYLE_RESET,
-                                           current.first, current.second.base_directory()));
+                                           current.name, template_registry::path_of(current)));
     }
 
     return true;
@@ -319,16 +508,10 @@ bool template_show_handler(const std::vector<std::string>& arguments) {
     }
 
     // count files in the template
-    int file_count = 0;
-    for (auto& directory_entry : std::filesystem::recursive_directory_iterator { template_path }) {
-        if (std::error_code code; directory_entry.is_regular_file(code) && !code &&
-                                  directory_entry.path().filename() != project_template::template_info_file_name) {
-            file_count++;
-        }
-    }
+    auto const& the_template = std::get<project_template>(maybe_template);
+    auto file_count = count_template_files(the_template);
 
     // print info about the template
-    auto const& the_template = std::get<project_template>(maybe_template);
     auto& info = the_template.info();
     auto& commands = info.commands();
     print_unformatted_line(std::format("project template `" STYLE_BLUE "{}" STYLE_RESET "`", arguments[0]));
@@ -336,6 +519,8 @@ bool template_show_handler(const std::vector<std::string>& arguments) {
         std::format(STYLE_BLUE "path" STYLE_RESET ": " STYLE_YELLOW "{}",
                     static_cast<std::string>(std::filesystem::absolute(the_template.base_directory()))));
     print_unformatted_line(std::format(STYLE_BLUE "file count" STYLE_RESET ": " STYLE_YELLOW "{}", file_count));
+    print_unformatted_line(std::format(STYLE_BLUE "storage" STYLE_RESET ": " STYLE_YELLOW "{}",
+                                       the_template.is_packed() ? "packed" : "directory"));
 
     // print commands to be run
     if (commands.empty()) {
@@ -344,8 +529,15 @@ bool template_show_handler(const std::vector<std::string>& arguments) {
     } else {
         print_unformatted_line(std::format(STYLE_BLUE "commands to be run on project creation: " STYLE_RESET));
         for (usz index = 0; index < commands.size(); index++)
-            print_unformatted_line(std::format(" {} - " STYLE_YELLOW "{}" STYLE_RESET, index, commands[index]));
+            print_unformatted_line(std::format(" {} - " STYLE_YELLOW "{}" STYLE_RESET "{}", index, commands[index],
+                                               describe_command_settings(info, index)));
+        if (info.timeout_seconds().has_value())
+            print_unformatted_line(std::format(STYLE_BLUE "all commands have to finish within" STYLE_RESET
+                                               ": " STYLE_YELLOW "{}s" STYLE_RESET,
+                                               info.timeout_seconds().value()));
     }
+    print_path_rules(info);
+    print_default_values(info);
 
     return true;
 }
@@ -360,12 +552,18 @@ bool template_remove_handler(const std::vector<std::string>& arguments) {
         print_fatal_and_exit("could not successfuly perform the operation, aborting...");
     }
 
-    // if the template exists, ask user for confirmation
+    // if the template exists, ask user for confirmation - packed templates are removed by removing the pack, blobs
+    // used only by a removed template directory are removed from the blob store along with it
     if (prompt_user_boolean(std::format("do you really want to remove project named `" STYLE_BLUE "{}" STYLE_RESET "`",
                                         arguments[0]))) {
+        auto& the_template = std::get<project_template>(maybe_template);
+        auto registry_time = template_registry::directory_time();
         std::error_code code {};
-        std::filesystem::remove_all(template_path, code);
-        if (code) {
+        bool removed = the_template.is_packed()
+                           ? std::filesystem::remove(the_template.base_directory(), code) && !code
+                           : !blob_store::remove_template_directory(the_template.base_directory()).has_value();
+        template_registry::update(arguments[0], registry_time);
+        if (!removed) {
             print_error(std::format("cannot remove files from template named `{}`", arguments[0]));
             print_fatal_and_exit("could not successfuly perform the operation, aborting...");
         }
@@ -374,6 +572,128 @@ bool template_remove_handler(const std::vector<std::string>& arguments) {
     return true;
 }
 
+bool template_pack_handler(const std::vector<std::string>& arguments) {
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / arguments[0];
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    if (std::get<project_template>(maybe_template).is_packed()) {
+        print_error(std::format("template `{}` is already packed", arguments[0]));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    // write the pack and remove the template directory, the pack is used from now on
+    auto registry_time = template_registry::directory_time();
+    auto pack_path = template_path + template_pack::file_extension;
+    auto result = template_pack::pack_directory(template_path, pack_path);
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    std::error_code code {};
+    if (blob_store::remove_template_directory(template_path).has_value()) {
+        std::filesystem::remove(pack_path, code);
+        print_error(std::format("cannot remove directory of template `{}`", arguments[0]));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    template_registry::update(arguments[0], registry_time);
+
+    print_info(std::format("packed template `{}` into `{}` ({} bytes)", arguments[0], pack_path,
+                           std::filesystem::file_size(pack_path, code)));
+    return true;
+}
+
+bool template_unpack_handler(const std::vector<std::string>& arguments) {
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / arguments[0];
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+    if (!the_template.is_packed()) {
+        print_error(std::format("template `{}` is not packed", arguments[0]));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    // recreate the template directory, index it and remove the pack
+    auto registry_time = template_registry::directory_time();
+    std::error_code code {};
+    auto result = the_template.pack()->unpack_to(template_path);
+    if (result.has_value()) {
+        std::filesystem::remove_all(template_path, code);
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto maybe_index = template_index::build(template_path);
+    if (std::holds_alternative<std::string>(maybe_index)) {
+        print_warning(std::format("could not index template files - {}", std::get<std::string>(maybe_index)));
+    } else if (auto result = std::get<template_index>(maybe_index).save(template_path); result.has_value()) {
+        print_warning(std::format("could not write template index - {}", result.value()));
+    }
+    std::filesystem::remove(the_template.base_directory(), code);
+    if (code) {
+        print_error(std::format("cannot remove pack of template `{}`", arguments[0]));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    template_registry::update(arguments[0], registry_time);
+
+    print_info(std::format("unpacked template `{}` into `{}`", arguments[0], template_path));
+    return true;
+}
+
+bool template_gc_handler(const std::vector<std::string>& arguments) {
+    UNUSED(arguments);
+
+    // remove all blobs which are not linked from any template anymore
+    auto result = blob_store::collect_garbage();
+    if (std::holds_alternative<std::string>(result)) {
+        print_error(std::get<std::string>(result));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& collected = std::get<blob_store::collection_result>(result);
+    print_info(std::format("removed {} unused blobs ({} bytes)", collected.removed_blobs, collected.removed_bytes));
+    return true;
+}
+
+bool template_timeout_handler(const std::vector<std::string>& arguments) {
+    // parse the timeout, if it is not given, the timeout is removed
+    std::optional<u64> timeout_seconds {};
+    if (arguments.size() == 2) {
+        timeout_seconds = parse_duration_seconds(arguments[1]);
+        if (!timeout_seconds.has_value() || timeout_seconds.value() == 0) {
+            print_error(std::format("`{}` is not a valid timeout", arguments[1]));
+            print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+        }
+    }
+
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / arguments[0];
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+
+    // set the timeout and resave the info
+    the_template.info().set_timeout_seconds(timeout_seconds);
+    auto result = the_template.save_info();
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    return true;
+}
+
 bool template_cmd_add_handler(const std::vector<std::string>& arguments) {
     // get arguments
     auto template_name = arguments[0];
@@ -387,11 +707,11 @@ bool template_cmd_add_handler(const std::vector<std::string>& arguments) {
         print_error(std::format("cannot find a template named `{}` to remove", arguments[0]));
         print_fatal_and_exit("could not successfuly perform the operation, aborting...");
     }
-    auto const& the_template = std::get<project_template>(maybe_template);
+    auto& the_template = std::get<project_template>(maybe_template);
     auto& info = the_template.info();
 
     // add command to the info and resave it
-    info.commands().push_back(command);
+    info.add_command(command);
     auto result = the_template.save_info();
     if (result.has_value()) {
         print_error(result.value());
@@ -423,7 +743,7 @@ bool template_cmd_remove_handler(const std::vector<std::string>& arguments) {
         print_error(std::format("cannot find a template named `{}` to remove", arguments[0]));
         print_fatal_and_exit("could not successfuly perform the operation, aborting...");
     }
-    auto const& the_template = std::get<project_template>(maybe_template);
+    auto& the_template = std::get<project_template>(maybe_template);
     auto& info = the_template.info();
     auto& commands = info.commands();
 
@@ -438,7 +758,7 @@ bool template_cmd_remove_handler(const std::vector<std::string>& arguments) {
     if (prompt_user_boolean(std::format("do you really want to remove command `" STYLE_BLUE "{}" STYLE_RESET
                                         "` from template named `" STYLE_BLUE "{}" STYLE_RESET "`",
                                         command, template_name))) {
-        commands.erase(commands.begin() + index);
+        info.remove_command(index);
         auto result = the_template.save_info();
         if (result.has_value()) {
             print_error(result.value());
@@ -449,6 +769,154 @@ bool template_cmd_remove_handler(const std::vector<std::string>& arguments) {
     return true;
 }
 
+bool template_cmd_after_handler(const std::vector<std::string>& arguments) {
+    // get arguments
+    auto template_name = arguments[0];
+    auto command_index = arguments[1];
+
+    // parse command index and indices of its dependencies (given as a comma-separated list)
+    usz index = {};
+    std::vector<usz> dependencies {};
+    try {
+        index = std::stoll(command_index);
+    } catch (...) {
+        print_error(std::format("`{}` is not a valid integral index", command_index));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    if (arguments.size() == 3) {
+        std::istringstream stream { arguments[2] };
+        for (std::string dependency {}; std::getline(stream, dependency, ',');) {
+            try {
+                dependencies.push_back(std::stoll(trim_string(dependency)));
+            } catch (...) {
+                print_error(std::format("`{}` is not a valid integral index", dependency));
+                print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+            }
+        }
+    }
+
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / template_name;
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+
+    // set dependencies of the command and resave the info
+    auto result = the_template.info().set_dependencies(index, std::move(dependencies));
+    if (!result.has_value())
+        result = the_template.save_info();
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    return true;
+}
+
+bool template_cmd_limit_handler(const std::vector<std::string>& arguments) {
+    // get arguments
+    auto template_name = arguments[0];
+    auto command_index = arguments[1];
+    auto limit_name = arguments[2];
+
+    // parse command index, kind of the limit and its value (if it is not given, the limit is removed)
+    usz index = {};
+    try {
+        index = std::stoll(command_index);
+    } catch (...) {
+        print_error(std::format("`{}` is not a valid integral index", command_index));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    command_limit limit {};
+    if (limit_name == "timeout") {
+        limit = command_limit::timeout;
+    } else if (limit_name == "cpu") {
+        limit = command_limit::cpu_time;
+    } else if (limit_name == "memory") {
+        limit = command_limit::memory;
+    } else {
+        print_error(std::format("`{}` is not a valid limit (expected timeout, cpu or memory)", limit_name));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    std::optional<u64> value {};
+    if (arguments.size() == 4) {
+        value = limit == command_limit::memory ? parse_byte_size(arguments[3]) : parse_duration_seconds(arguments[3]);
+        if (!value.has_value()) {
+            print_error(std::format("`{}` is not a valid value of the {} limit", arguments[3], limit_name));
+            print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+        }
+    }
+
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / template_name;
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+
+    // set the limit and resave the info
+    auto result = the_template.info().set_limit(index, limit, value);
+    if (!result.has_value())
+        result = the_template.save_info();
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    return true;
+}
+
+bool template_cmd_directory_handler(const std::vector<std::string>& arguments) {
+    // get arguments
+    auto template_name = arguments[0];
+    auto command_index = arguments[1];
+
+    // parse command index and the directory (if it is not given, the command runs in the project directory)
+    usz index = {};
+    try {
+        index = std::stoll(command_index);
+    } catch (...) {
+        print_error(std::format("`{}` is not a valid integral index", command_index));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    std::optional<std::string> directory {};
+    if (arguments.size() == 3) {
+        directory = trim_string(arguments[2]);
+        if (std::filesystem::path { directory.value() }.is_absolute()) {
+            print_error(std::format("`{}` is not a path relative to the project directory", directory.value()));
+            print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+        }
+    }
+
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / template_name;
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+
+    // set the directory and resave the info
+    auto result = the_template.info().set_directory(index, directory);
+    if (!result.has_value())
+        result = the_template.save_info();
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    return true;
+}
+
 bool template_cmd_list_handler(const std::vector<std::string>& arguments) {
     // get template by name
     std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
@@ -469,8 +937,142 @@ bool template_cmd_list_handler(const std::vector<std::string>& arguments) {
     } else {
         print_unformatted_line(std::format(STYLE_BLUE "commands to be run on project creation: " STYLE_RESET));
         for (usz index = 0; index < commands.size(); index++)
-            print_unformatted_line(std::format(" {} - " STYLE_YELLOW "{}" STYLE_RESET, index, commands[index]));
+            print_unformatted_line(std::format(" {} - " STYLE_YELLOW "{}" STYLE_RESET "{}", index, commands[index],
+                                               describe_command_settings(info, index)));
+        if (info.timeout_seconds().has_value())
+            print_unformatted_line(std::format(STYLE_BLUE "all commands have to finish within" STYLE_RESET
+                                               ": " STYLE_YELLOW "{}s" STYLE_RESET,
+                                               info.timeout_seconds().value()));
+    }
+    return true;
+}
+
+bool template_rule_add_handler(const std::vector<std::string>& arguments) {
+    // get arguments
+    auto template_name = arguments[0];
+    auto action_name = arguments[1];
+    auto pattern = trim_string(arguments[2]);
+
+    // parse the action of the rule
+    auto action = parse_path_action(action_name);
+    if (!action.has_value()) {
+        print_error(std::format("`{}` is not a valid action (expected render, copy, skip or executable)", action_name));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / template_name;
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+
+    // add the rule and resave the info
+    auto result = the_template.info().add_path_rule({ action.value(), pattern });
+    if (!result.has_value())
+        result = the_template.save_info();
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    return true;
+}
+
+bool template_rule_remove_handler(const std::vector<std::string>& arguments) {
+    // get arguments
+    auto template_name = arguments[0];
+    auto rule_index = arguments[1];
+
+    // parse rule index
+    usz index = {};
+    try {
+        index = std::stoll(rule_index);
+    } catch (...) {
+        print_error(std::format("`{}` is not a valid integral index", rule_index));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / template_name;
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+
+    // check if index is valid
+    auto& info = the_template.info();
+    if (index >= info.path_rules().size()) {
+        print_error(std::format("rule index {} is out of bounds for template `{}`", index, template_name));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
     }
+
+    // remove the rule and resave the info
+    info.remove_path_rule(index);
+    auto result = the_template.save_info();
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    return true;
+}
+
+bool template_rule_list_handler(const std::vector<std::string>& arguments) {
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / arguments[0];
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    print_path_rules(std::get<project_template>(maybe_template).info());
+    return true;
+}
+
+bool template_default_set_handler(const std::vector<std::string>& arguments) {
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / arguments[0];
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+    auto& the_template = std::get<project_template>(maybe_template);
+
+    // set or remove the default value and resave the info
+    auto value = arguments.size() == 3 ? arguments[2] : std::optional<std::string> {};
+    auto result = the_template.info().set_default_value(trim_string(arguments[1]), std::move(value));
+    if (!result.has_value())
+        result = the_template.save_info();
+    if (result.has_value()) {
+        print_error(result.value());
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    return true;
+}
+
+bool template_default_list_handler(const std::vector<std::string>& arguments) {
+    // get template by name
+    std::string template_path = std::filesystem::path { os::get_lppm_config_directory() } /
+                                project_template::templates_directory_name / arguments[0];
+    auto maybe_template = project_template::template_from_directory(template_path);
+    if (std::holds_alternative<std::string>(maybe_template)) {
+        print_error(std::get<std::string>(maybe_template));
+        print_fatal_and_exit("could not successfuly perform the operation, aborting...");
+    }
+
+    print_default_values(std::get<project_template>(maybe_template).info());
     return true;
 }
 
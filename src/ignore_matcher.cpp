@@ -0,0 +1,123 @@
+#include <lppm/ignore_matcher.h>
+
+#include <filesystem>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include <lppm/common.h>
+#include <lppm/file_contents.h>
+#include <lppm/glob.h>
+
+namespace lppm {
+
+ignore_matcher ignore_matcher::load(const std::string& directory) {
+    auto contents = file_contents::read(std::filesystem::path { directory } / ignore_file_name);
+    if (std::holds_alternative<std::string>(contents))
+        return {};
+    return parse(std::get<file_contents>(contents).view());
+}
+
+ignore_matcher ignore_matcher::parse(std::string_view contents) {
+    ignore_matcher result {};
+    while (!contents.empty()) {
+        auto line_end = contents.find('\n');
+        auto line = contents.substr(0, line_end);
+        contents.remove_prefix(line_end == std::string_view::npos ? contents.size() : line_end + 1);
+
+        // trailing whitespace is dropped, unless it is escaped
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t') &&
+               !(line.size() >= 2 && line[line.size() - 2] == '\\'))
+            line.remove_suffix(1);
+        if (line.empty() || line.front() == '#')
+            continue;
+
+        pattern parsed { pattern_kind::glob, {} };
+        if (line.front() == '!') {
+            parsed.negated = true;
+            line.remove_prefix(1);
+        }
+        if (line.ends_with('/')) {
+            parsed.directories_only = true;
+            line.remove_suffix(1);
+        }
+        parsed.anchored = line.find('/') != std::string_view::npos;
+        if (line.starts_with('/'))
+            line.remove_prefix(1);
+        if (line.empty())
+            continue;
+
+        // patterns without any wildcards are compared directly, "*<suffix>" ones only check the end of the name
+        static constexpr std::string_view special_characters = "*?[\\";
+        if (line.find_first_of(special_characters) == std::string_view::npos) {
+            parsed.kind = pattern_kind::literal;
+            parsed.text = line;
+        } else if (!parsed.anchored && line.starts_with('*') &&
+                   line.find_first_of(special_characters, 1) == std::string_view::npos) {
+            parsed.kind = pattern_kind::suffix;
+            parsed.text = line.substr(1);
+        } else {
+            parsed.text = line;
+        }
+
+        usz index = result.m_patterns.size();
+        if (parsed.kind == pattern_kind::literal && !parsed.anchored)
+            result.m_literal_names[parsed.text].push_back(index);
+        else
+            result.m_other_patterns.push_back(index);
+        result.m_patterns.push_back(std::move(parsed));
+    }
+    return result;
+}
+
+bool ignore_matcher::is_ignored(std::string_view relative_path, bool is_directory) const {
+    if (m_patterns.empty())
+        return false;
+    auto name_start = relative_path.rfind('/');
+    auto name = name_start == std::string_view::npos ? relative_path : relative_path.substr(name_start + 1);
+
+    // the last matching pattern decides - the literal ones are looked up by name first, so only the other patterns
+    // defined after the matching literal one have to be checked
+    std::optional<usz> last_match {};
+    if (auto iterator = m_literal_names.find(std::string { name }); iterator != m_literal_names.end()) {
+        for (auto index : iterator->second | std::views::reverse) {
+            if (!m_patterns[index].directories_only || is_directory) {
+                last_match = index;
+                break;
+            }
+        }
+    }
+    for (auto index : m_other_patterns | std::views::reverse) {
+        if (last_match.has_value() && index < last_match.value())
+            break;
+        if (matches(m_patterns[index], relative_path, name, is_directory)) {
+            last_match = index;
+            break;
+        }
+    }
+
+    return last_match.has_value() && !m_patterns[last_match.value()].negated;
+}
+
+bool ignore_matcher::empty() const { return m_patterns.empty(); }
+
+bool ignore_matcher::matches(const pattern& pattern, std::string_view relative_path, std::string_view name,
+                             bool is_directory) const {
+    if (pattern.directories_only && !is_directory)
+        return false;
+
+    auto subject = pattern.anchored ? relative_path : name;
+    switch (pattern.kind) {
+        case pattern_kind::literal:
+            return subject == pattern.text;
+        case pattern_kind::suffix:
+            return subject.ends_with(pattern.text);
+        case pattern_kind::glob:
+            return match_glob(pattern.text, subject);
+    }
+    return false;
+}
+
+} // namespace lppm
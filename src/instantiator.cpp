@@ -0,0 +1,723 @@
+#include <lppm/instantiator.h>
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <lppm/cli.h>
+#include <lppm/common.h>
+#include <lppm/directory_walker.h>
+#include <lppm/options.h>
+#include <lppm/os.h>
+#include <lppm/profiler.h>
+#include <lppm/substitutor.h>
+#include <lppm/template.h>
+#include <lppm/thread_pool.h>
+#include <lppm/utils.h>
+
+namespace lppm {
+
+project_instantiator::project_instantiator(const project_template& the_template, std::string target_path,
+                                           variable_scope& scope)
+    : project_instantiator(the_template, { { std::move(target_path), &scope } }) {}
+
+project_instantiator::project_instantiator(const project_template& the_template, std::vector<target> targets)
+    : m_template(the_template), m_targets(std::move(targets)),
+      m_ignore(ignore_matcher::load(the_template.base_directory())),
+      m_index(template_index::load(the_template.base_directory())) {
+    for (usz index = 0; index < m_targets.size(); index++) {
+        m_resolvers.push_back([this, index](const std::string& variable_name) -> const std::string& {
+            // all variables are resolved before rendering starts, the value tables are only read from here on
+            return *m_value_tables[index][id_of_variable(variable_name)];
+        });
+    }
+}
+
+project_instantiator::~project_instantiator() {
+    close_target_directories();
+    close_source_directories();
+}
+
+std::optional<std::string> project_instantiator::instantiate(usz worker_count) {
+    thread_pool pool { worker_count };
+
+    // find all variables used by the template, ask for the missing ones and write the project out
+    {
+        profile_span span { "discover" };
+        if (auto result = discover(pool); result.has_value())
+            return result;
+    }
+    {
+        profile_span span { "resolve variables" };
+        if (auto result = resolve_missing_variables(); result.has_value())
+            return result;
+        fill_value_tables();
+    }
+    profile_span span { "render" };
+    return render(pool);
+}
+
+std::optional<std::string> project_instantiator::discover(thread_pool& pool) {
+    // collect all entries, either from the template directory or from the template pack
+    // files of the template directory are scanned during the walk already, packed files are described by the pack
+    auto collected = m_template.is_packed() ? collect_packed_entries(*m_template.pack()) : collect_entries(pool);
+    pool.wait();
+    if (collected.has_value())
+        return collected;
+    if (m_error.has_value())
+        return m_error;
+    link_entries();
+    if (!m_template.is_packed()) {
+        profile_span span { "save index" };
+        save_index();
+    }
+
+    // merge variables in walk order - names of entries first, then file contents and template commands at the end
+    // (names of parent directories were already merged with the parent entries)
+    auto add_variables = [&](const std::vector<std::string>& variables) {
+        for (auto& variable : variables) {
+            if (m_variable_ids.try_emplace(variable, m_discovered_variables.size()).second)
+                m_discovered_variables.push_back(variable);
+        }
+    };
+    for (auto& entry : m_entries) {
+        add_variables(entry.name->variables());
+        add_variables(entry.variables);
+    }
+    auto& info = m_template.info();
+    for (usz index = 0; index < info.commands().size(); index++) {
+        add_variables(compiled_text::compile(info.commands()[index]).variables());
+        if (auto& directory = info.settings_of(index).directory; directory.has_value())
+            add_variables(compiled_text::compile(directory.value()).variables());
+    }
+
+    return {};
+}
+
+std::optional<std::string> project_instantiator::collect_entries(thread_pool& pool) {
+    // walk the template directory, collecting all entries
+    profile_span span { "walk" };
+    std::optional<std::string> error {};
+
+    // descriptors of the template directories are kept open (up to the budget), so files are read relative to them -
+    // they are looked up by the relative paths of the directories, the template directory itself has an empty one
+    m_source_root_fd = os::open_directory({ m_template.base_directory() });
+    std::unordered_map<std::string_view, int> source_fds { { std::string_view {}, m_source_root_fd } };
+    auto fill_source_location = [&](template_entry& entry, const directory_walker::entry& walked) {
+        auto parent_path = walked.relative_path().substr(
+            0, walked.name_offset == walked.relative_offset ? 0 : walked.name_offset - walked.relative_offset - 1);
+        if (auto parent = source_fds.find(parent_path); parent != source_fds.end())
+            entry.source_parent_fd = parent->second;
+        entry.source_name_offset = walked.name_offset;
+        entry.is_symbolic_link = walked.is_symbolic_link;
+    };
+
+    auto walk_error = directory_walker::walk(m_template.base_directory(), [&](const directory_walker::entry& walked) {
+        profiler::the().count(profiler::counter::entries_walked);
+
+        // ignored and skipped directories are not entered at all
+        auto relative_path = walked.relative_path();
+        auto actions = m_template.info().actions_for(relative_path, walked.is_directory);
+        if (actions.contents == path_action::skip || m_ignore.is_ignored(relative_path, walked.is_directory))
+            return directory_walker::action::skip;
+
+        if (walked.is_directory) {
+            auto& entry = m_entries.emplace_back(std::string { walked.path }, std::string { relative_path },
+                                                 file_kind::directory, actions);
+            fill_source_location(entry, walked);
+            if (m_open_source_directory_count < directory_descriptor_budget) {
+                entry.source_fd = os::open_directory(source_location_of(entry));
+                if (entry.source_fd != entry_location::no_descriptor) {
+                    m_open_source_directory_count++;
+                    source_fds.emplace(entry.relative_path, entry.source_fd);
+                }
+            }
+            return directory_walker::action::proceed;
+        }
+
+        // if the entry refers to the .lppm_template or .lppm_index file, continue
+        if (walked.name_offset == walked.relative_offset &&
+            template_index::is_template_metadata_file(std::string { walked.name() }))
+            return directory_walker::action::proceed;
+
+        auto stamp = directory_walker::stamp_of(walked);
+        if (!stamp.has_value()) {
+            error = std::format("could not read attributes of file `{}`", walked.path);
+            return directory_walker::action::stop;
+        }
+        auto& entry = m_entries.emplace_back(std::string { walked.path }, std::string { relative_path },
+                                             file_kind::rendered, actions, stamp->size, stamp->modification_time);
+        fill_source_location(entry, walked);
+        schedule_discovery(pool, entry);
+        return directory_walker::action::proceed;
+    });
+    if (walk_error.has_value())
+        return walk_error;
+    return error;
+}
+
+void project_instantiator::schedule_discovery(thread_pool& pool, template_entry& entry) {
+    // files copied because of a rule are not scanned at all, unchanged files are taken from the index and the
+    // remaining ones are scanned on the workers - the index is updated by them in the meantime
+    if (entry.actions.contents == path_action::copy) {
+        entry.kind = file_kind::copied;
+        return;
+    }
+    {
+        std::lock_guard lock { m_index_mutex };
+        auto index_entry = m_index.find_fresh(entry.relative_path, entry.size, entry.modification_time);
+        if (index_entry != nullptr && !(index_entry->kind == template_index::content_kind::binary &&
+                                        entry.actions.contents == path_action::render)) {
+            apply_index_entry(entry, *index_entry);
+            return;
+        }
+    }
+
+    pool.submit([this, &entry] {
+        if (m_failed)
+            return;
+        auto result = discover_file(entry);
+        if (result.has_value())
+            record_error(result.value());
+    });
+}
+
+std::optional<std::string> project_instantiator::collect_packed_entries(const template_pack& pack) {
+    // entries of the pack are stored in the walk order, with ignored entries already left out
+    for (auto& packed : pack.entries()) {
+        bool is_directory = packed.type == template_pack::entry_type::directory;
+        auto actions = m_template.info().actions_for(packed.path, is_directory);
+        if (actions.contents == path_action::skip)
+            continue;
+        if (!is_directory && packed.path.find('/') == std::string::npos &&
+            template_index::is_template_metadata_file(packed.path))
+            continue;
+
+        std::string source_path = std::filesystem::path { m_template.base_directory() } / packed.path;
+        template_entry entry { source_path, packed.path, file_kind::directory, actions };
+        if (is_directory) {
+            m_entries.push_back(std::move(entry));
+            continue;
+        }
+
+        // the contents stay in the mapped pack, so even large files are rendered at once instead of being streamed
+        entry.size = packed.contents.size();
+        entry.packed_contents = packed.contents;
+        switch (packed.kind) {
+            case template_index::content_kind::binary:
+            case template_index::content_kind::verbatim:
+                entry.kind = file_kind::copied;
+                break;
+            case template_index::content_kind::rendered:
+            case template_index::content_kind::streamed:
+                entry.kind = file_kind::rendered;
+                entry.variables = packed.variables;
+                break;
+        }
+        if (actions.contents == path_action::copy) {
+            entry.kind = file_kind::copied;
+            entry.variables.clear();
+        } else if (actions.contents == path_action::render && packed.kind == template_index::content_kind::binary) {
+            entry.kind = file_kind::rendered;
+            entry.variables = compiled_text::compile(packed.contents).variables();
+        }
+        m_entries.push_back(std::move(entry));
+    }
+    return {};
+}
+
+void project_instantiator::link_entries() {
+    // parents are always stored before their children, so the parent of every entry is known by the time it is reached
+    // - the relative paths are not changed anymore, so views of them stay valid
+    std::unordered_map<std::string_view, usz> directory_indices {};
+    for (usz index = 0; index < m_entries.size(); index++) {
+        auto& entry = m_entries[index];
+        std::string_view path = entry.relative_path;
+        auto separator = path.rfind('/');
+        if (separator != std::string_view::npos) {
+            if (auto iterator = directory_indices.find(path.substr(0, separator)); iterator != directory_indices.end())
+                entry.parent = iterator->second;
+        }
+
+        // entries whose parent directory is not among the entries keep their whole relative path as the name
+        entry.name = compiled_text::compile(entry.parent == no_parent ? path : path.substr(separator + 1));
+        if (entry.kind == file_kind::directory)
+            directory_indices.emplace(path, index);
+    }
+}
+
+std::optional<std::string> project_instantiator::discover_file(template_entry& entry) {
+    profile_span span { "scan", entry.relative_path };
+    profiler::the().count(profiler::counter::files_scanned);
+    profiler::the().count(profiler::counter::bytes_scanned, entry.size);
+    std::optional<file_contents> contents {};
+    auto source_location = source_location_of(entry);
+    auto index_entry = template_index::scan_file(source_location, entry.size, entry.modification_time, &contents);
+    if (std::holds_alternative<std::string>(index_entry))
+        return std::get<std::string>(index_entry);
+
+    // files which look binary, but are rendered because of a rule, are scanned again as text - such result is not
+    // stored in the index, as the index classifies files by their contents only
+    bool forced_rendering = std::get<template_index::file_entry>(index_entry).kind ==
+                                template_index::content_kind::binary &&
+                            entry.actions.contents == path_action::render;
+    if (forced_rendering) {
+        index_entry = template_index::scan_file(source_location, entry.size, entry.modification_time, &contents,
+                                                false);
+        if (std::holds_alternative<std::string>(index_entry))
+            return std::get<std::string>(index_entry);
+    }
+    apply_index_entry(entry, std::get<template_index::file_entry>(index_entry));
+
+    // keep the contents for rendering, if they fit in what is left of the budget - files that do not fit take nothing
+    // from it, so smaller files found later may still be kept
+    if (contents.has_value()) {
+        usz cached_size = m_cached_size.load();
+        while (cached_size + contents->size() <= discovery_cache_budget &&
+               !m_cached_size.compare_exchange_weak(cached_size, cached_size + contents->size())) {
+        }
+        if (cached_size + contents->size() <= discovery_cache_budget)
+            entry.cached_contents = std::move(contents);
+    }
+
+    if (forced_rendering)
+        return {};
+    std::lock_guard lock { m_index_mutex };
+    m_index.update(entry.relative_path, std::move(std::get<template_index::file_entry>(index_entry)));
+    return {};
+}
+
+void project_instantiator::apply_index_entry(template_entry& entry, const template_index::file_entry& index_entry) {
+    // binary files and files without markers are copied by the kernel (reflinked if the filesystem supports it)
+    switch (index_entry.kind) {
+        case template_index::content_kind::binary:
+        case template_index::content_kind::verbatim:
+            entry.kind = file_kind::copied;
+            break;
+        case template_index::content_kind::rendered:
+            entry.kind = file_kind::rendered;
+            break;
+        case template_index::content_kind::streamed:
+            entry.kind = file_kind::streamed;
+            break;
+    }
+    entry.variables = index_entry.variables;
+    entry.markers = index_entry.markers;
+}
+
+void project_instantiator::save_index() {
+    // forget about files that were removed from the template
+    std::vector<std::string> relative_paths {};
+    for (auto& entry : m_entries) {
+        if (entry.kind != file_kind::directory)
+            relative_paths.push_back(entry.relative_path);
+    }
+    m_index.retain_only(relative_paths);
+
+    // the index is only a cache, so failing to write it is not fatal
+    if (!m_index.is_modified())
+        return;
+    if (auto result = m_index.save(m_template.base_directory()); result.has_value())
+        print_warning(std::format("could not update template index - {}", result.value()));
+}
+
+std::optional<std::string> project_instantiator::resolve_missing_variables() {
+    // in non-interactive mode, all missing variables of all targets are reported at once, before anything is written
+    bool is_interactive = options::the().prompts() == prompt_policy::interactive;
+    std::string missing_description {};
+    for (auto& current : m_targets) {
+        std::vector<std::string> missing_variables {};
+        for (auto& variable : m_discovered_variables) {
+            if (current.scope->find(variable) == nullptr)
+                missing_variables.push_back(variable);
+        }
+        if (missing_variables.empty())
+            continue;
+
+        if (!is_interactive) {
+            missing_description += std::format("\n  {}:", current.path);
+            for (auto& variable : missing_variables)
+                missing_description += std::format(" {}", variable);
+            continue;
+        }
+
+        // ask for all missing values of the target at once
+        if (m_targets.size() == 1) {
+            print_info(std::format("template uses {} variable(s) without a value, please provide them",
+                                   missing_variables.size()));
+        } else {
+            print_info(std::format("template uses {} variable(s) without a value for project `{}`, please provide them",
+                                   missing_variables.size(), current.path));
+        }
+        for (auto& variable : missing_variables)
+            current.scope->resolve(variable);
+    }
+
+    if (missing_description.empty())
+        return {};
+    return std::format("template uses variable(s) without a value, which cannot be asked for in non-interactive mode "
+                       "- give them with -D <name>=<value>, --vars-file or LPPM_VAR_<name> environment variables:{}",
+                       missing_description);
+}
+
+void project_instantiator::fill_value_tables() {
+    // scopes are not modified anymore, so pointers to their values stay valid until rendering is done
+    m_value_tables.resize(m_targets.size());
+    for (usz index = 0; index < m_targets.size(); index++) {
+        auto& table = m_value_tables[index];
+        table.reserve(m_discovered_variables.size());
+        for (auto& variable : m_discovered_variables)
+            table.push_back(&m_targets[index].scope->resolve(variable));
+    }
+}
+
+usz project_instantiator::id_of_variable(const std::string& name) const {
+    auto iterator = m_variable_ids.find(name);
+    if (iterator == m_variable_ids.end())
+        print_internal_error_and_exit(
+            std::format("variable `{}` was not found during discovery, but is used in rendering", name));
+    return iterator->second;
+}
+
+std::optional<std::string> project_instantiator::render(thread_pool& pool) {
+    m_render_pool = &pool;
+    create_write_batches(pool.worker_count());
+    for (auto& target : m_targets)
+        m_target_fds.push_back(os::open_directory({ target.path }));
+
+    for (auto& entry : m_entries) {
+        if (m_failed)
+            break;
+
+        // if the entry refers to the directory, create it in target directories - entries are stored in pre-order, so
+        // parent directories always exist before any file is written into them
+        auto target_locations = target_locations_of(entry);
+        if (entry.kind == file_kind::directory) {
+            create_directories(entry, target_locations);
+            continue;
+        }
+
+        // rendered files are read and compiled once for all targets, other files are copied into every target
+        if (entry.kind == file_kind::rendered) {
+            pool.submit([this, &entry, target_locations = std::move(target_locations)]() mutable {
+                if (!m_failed)
+                    render_to_targets(entry, std::move(target_locations));
+            });
+            continue;
+        }
+        for (usz index = 0; index < target_locations.size(); index++) {
+            pool.submit([this, &entry, index, location_in_target = std::move(target_locations[index])] {
+                if (!m_failed)
+                    render_to_target(entry, index, location_in_target, nullptr);
+            });
+        }
+    }
+
+    pool.wait();
+
+    // write out the files still waiting in batches, the workers are idle by now - directories are not needed after that
+    {
+        profile_span span { "flush batches" };
+        for (auto& batch : m_write_batches)
+            flush_write_batch(batch);
+    }
+    close_target_directories();
+    close_source_directories();
+    report_write_batches();
+    return m_error;
+}
+
+void project_instantiator::create_directories(template_entry& entry,
+                                              const std::vector<entry_location>& target_locations) {
+    profile_span span { "mkdir", entry.relative_path };
+    entry.target_paths.reserve(target_locations.size());
+    entry.target_fds.reserve(target_locations.size());
+    for (auto& location_in_target : target_locations) {
+        profiler::the().count(profiler::counter::directories_created);
+        int directory_fd = entry_location::no_descriptor;
+        if (auto result = os::create_directory(location_in_target); result.has_value()) {
+            record_error(result.value());
+        } else if (m_open_directory_count < directory_descriptor_budget) {
+            directory_fd = os::open_directory(location_in_target);
+            if (directory_fd != entry_location::no_descriptor)
+                m_open_directory_count++;
+        }
+        entry.target_paths.push_back(location_in_target.path);
+        entry.target_fds.push_back(directory_fd);
+    }
+}
+
+void project_instantiator::render_to_targets(template_entry& entry, std::vector<entry_location> target_locations) {
+    auto maybe_source = prepare_source(entry);
+    if (std::holds_alternative<std::string>(maybe_source)) {
+        record_error(std::get<std::string>(maybe_source));
+        return;
+    }
+
+    // the first target is rendered right away, the remaining ones on whichever workers are free - the source is
+    // released once the last of them is done
+    auto& source = std::get<std::shared_ptr<const rendered_source>>(maybe_source);
+    for (usz index = 1; index < target_locations.size(); index++) {
+        m_render_pool->submit([this, &entry, source, index, location_in_target = std::move(target_locations[index])] {
+            if (!m_failed)
+                render_to_target(entry, index, location_in_target, source.get());
+        });
+    }
+    render_to_target(entry, 0, target_locations[0], source.get());
+}
+
+std::variant<std::string, std::shared_ptr<const project_instantiator::rendered_source>>
+project_instantiator::prepare_source(template_entry& entry) {
+    // read file contents, unless they were kept since discovery (or they are in the pack)
+    auto source = std::make_shared<rendered_source>();
+    if (entry.cached_contents.has_value()) {
+        source->contents = std::move(entry.cached_contents);
+        entry.cached_contents.reset();
+    } else if (!entry.packed_contents.has_value()) {
+        profile_span span { "read", entry.relative_path };
+        auto maybe_contents = file_contents::read(source_location_of(entry));
+        if (std::holds_alternative<std::string>(maybe_contents))
+            return std::get<std::string>(maybe_contents);
+        source->contents = std::move(std::get<file_contents>(maybe_contents));
+        profiler::the().count(profiler::counter::files_read);
+        profiler::the().count(profiler::counter::bytes_read, source->contents->size());
+    }
+
+    // use marker positions from the index, if they are still valid - packs do not store marker positions, so packed
+    // files are always compiled here
+    auto text = entry.packed_contents.has_value() ? entry.packed_contents.value() : source->contents->view();
+    profile_span span { "compile", entry.relative_path };
+    if (!entry.markers.empty())
+        source->compiled = compiled_text::from_markers(text, entry.markers, entry.variables);
+    if (!source->compiled.has_value())
+        source->compiled = compiled_text::compile(text);
+    source->variable_ids.reserve(source->compiled->variables().size());
+    for (auto& variable : source->compiled->variables())
+        source->variable_ids.push_back(id_of_variable(variable));
+    if (profiler::the().is_enabled()) {
+        source->marker_count = std::ranges::count_if(source->compiled->segments(),
+                                                     [](auto& segment) { return !segment.is_literal(); });
+    }
+    return source;
+}
+
+void project_instantiator::render_to_target(const template_entry& entry, usz target_index,
+                                            const entry_location& target_location, const rendered_source* source) {
+    auto result = render_file(entry, target_index, target_location, source);
+    if (!result.has_value() && entry.actions.executable)
+        result = os::make_executable(target_location);
+    if (result.has_value())
+        record_error(result.value());
+}
+
+std::optional<std::string> project_instantiator::render_file(const template_entry& entry, usz target_index,
+                                                             const entry_location& target_location,
+                                                             const rendered_source* source) {
+    switch (entry.kind) {
+        case file_kind::directory:
+            return {};
+
+        case file_kind::copied: {
+            profile_span span { "copy", entry.relative_path };
+            profiler::the().count(profiler::counter::files_copied);
+            profiler::the().count(profiler::counter::bytes_copied, entry.size);
+            if (entry.packed_contents.has_value())
+                return write_file(target_location, entry.packed_contents.value());
+            return os::copy_file(source_location_of(entry), target_location);
+        }
+
+        case file_kind::streamed: {
+            profile_span span { "stream", entry.relative_path };
+            profiler::the().count(profiler::counter::files_rendered);
+            profiler::the().count(profiler::counter::bytes_rendered, entry.size);
+            return stream_substitutions(entry.source_path, target_location.path, m_resolvers[target_index]);
+        }
+
+        case file_kind::rendered:
+            break;
+    }
+
+    // do the substitutions and write a file
+    auto& compiled = source->compiled.value();
+    std::string after_substitutions {};
+    {
+        profile_span span { "substitute", entry.relative_path };
+        auto& table = m_value_tables[target_index];
+        std::vector<const std::string*> values {};
+        values.reserve(source->variable_ids.size());
+        for (auto id : source->variable_ids)
+            values.push_back(table[id]);
+        after_substitutions = compiled.render(values);
+    }
+    profiler::the().count(profiler::counter::files_rendered);
+    profiler::the().count(profiler::counter::bytes_rendered, after_substitutions.size());
+    profiler::the().count(profiler::counter::markers_substituted, source->marker_count);
+
+    // small files are queued in the batch of the current worker, they are written once the batch fills up - files
+    // made executable afterwards have to exist right away, so they are never queued
+    if (auto worker_index = m_render_pool->current_worker_index();
+        worker_index.has_value() && !m_write_batches.empty() &&
+        m_write_batches[worker_index.value()].writer->is_usable() && !entry.actions.executable &&
+        after_substitutions.size() <= io_uring_writer::max_file_size) {
+        auto& batch = m_write_batches[worker_index.value()];
+        batch.files.push_back({ target_location, std::move(after_substitutions) });
+        if (batch.files.size() == io_uring_writer::max_batch_size)
+            flush_write_batch(batch);
+        return {};
+    }
+
+    return write_file(target_location, after_substitutions);
+}
+
+void project_instantiator::create_write_batches(usz worker_count) {
+    if (options::the().io_backend() == io_backend_kind::synchronous)
+        return;
+
+    for (usz index = 0; index < worker_count; index++) {
+        auto writer = io_uring_writer::create();
+        if (!writer) {
+            if (options::the().io_backend() == io_backend_kind::io_uring)
+                print_warning("io_uring is not available, files will be written without it");
+            m_write_batches.clear();
+            return;
+        }
+        m_write_batches.push_back({ std::move(writer) });
+    }
+}
+
+void project_instantiator::flush_write_batch(write_batch& batch) {
+    if (batch.files.empty())
+        return;
+    profile_span span { "write batch" };
+
+    // files that could not be written in the batch are written again the regular way, which reports proper errors -
+    // once the ring fails, the writer is released and all following files of the worker are written the regular way
+    auto result = batch.writer->write_files(batch.files);
+    if (!result.lost_files.empty()) {
+        record_error(std::format("could not write a file `{}` - io_uring failed while writing it",
+                                 batch.files[result.lost_files.front()].location.path));
+    }
+    for (auto index : result.failed_files) {
+        if (m_failed)
+            break;
+        auto& file = batch.files[index];
+        if (auto written = write_file(file.location, file.contents); written.has_value())
+            record_error(written.value());
+    }
+    batch.files.clear();
+}
+
+void project_instantiator::report_write_batches() const {
+    // savings are only reported when io_uring was asked for explicitly
+    if (options::the().io_backend() != io_backend_kind::io_uring || m_write_batches.empty())
+        return;
+
+    io_uring_writer::statistics total {};
+    for (auto& batch : m_write_batches) {
+        total.files_written += batch.writer->stats().files_written;
+        total.batches += batch.writer->stats().batches;
+        total.submissions += batch.writer->stats().submissions;
+        total.batch_nanoseconds += batch.writer->stats().batch_nanoseconds;
+    }
+    if (total.files_written == 0)
+        return;
+
+    // every file written synchronously takes at least three system calls - open, write and close
+    print_info(std::format("io_uring wrote {} file(s) in {} batch(es) with {} system call(s) instead of {}, {} us per "
+                           "batch on average",
+                           total.files_written, total.batches, total.submissions, total.files_written * 3,
+                           total.batch_nanoseconds / std::max<usz>(total.batches, 1) / 1000));
+}
+
+std::optional<std::string> project_instantiator::write_file(const entry_location& target_location,
+                                                            std::string_view contents) {
+    profile_span span { "write", target_location.path };
+    return os::write_file(target_location, contents);
+}
+
+void project_instantiator::close_target_directories() {
+    for (auto& entry : m_entries) {
+        for (auto directory_fd : entry.target_fds)
+            os::close_directory(directory_fd);
+        entry.target_fds.clear();
+    }
+    for (auto directory_fd : m_target_fds)
+        os::close_directory(directory_fd);
+    m_target_fds.clear();
+    m_open_directory_count = 0;
+}
+
+void project_instantiator::close_source_directories() {
+    for (auto& entry : m_entries) {
+        os::close_directory(entry.source_fd);
+        entry.source_fd = entry_location::no_descriptor;
+    }
+    os::close_directory(m_source_root_fd);
+    m_source_root_fd = entry_location::no_descriptor;
+    m_open_source_directory_count = 0;
+}
+
+entry_location project_instantiator::source_location_of(const template_entry& entry) const {
+    // files which were not symbolic links during the walk are never followed, even if they were replaced by one since
+    entry_location location { entry.source_path };
+    location.follows_link = entry.is_symbolic_link;
+    if (entry.source_parent_fd != entry_location::no_descriptor) {
+        location.directory_fd = entry.source_parent_fd;
+        location.relative_offset = entry.source_name_offset;
+    }
+    return location;
+}
+
+std::vector<entry_location> project_instantiator::target_locations_of(const template_entry& entry) {
+    // only the name of the entry is substituted and appended to the path of its parent directory, which was already
+    // rendered for every target - paths of targets themselves are never substituted
+    auto& name = entry.name.value();
+    std::vector<entry_location> result {};
+    result.reserve(m_targets.size());
+    for (usz index = 0; index < m_targets.size(); index++) {
+        bool has_parent = entry.parent != no_parent;
+        auto& parent_path = has_parent ? m_entries[entry.parent].target_paths[index] : m_targets[index].path;
+        int parent_fd = has_parent ? m_entries[entry.parent].target_fds[index] : m_target_fds[index];
+        std::string rendered_name {};
+        if (name.has_markers()) {
+            profiler::the().count(profiler::counter::names_substituted);
+            rendered_name = name.render(name.resolve_values(m_resolvers[index]));
+        } else {
+            rendered_name = name.text();
+        }
+
+        // the entry is created relative to its parent only if its name is a single path component - values of
+        // variables may contain separators too, files are then written into directories that have to be created first
+        // (directories are created along with their parents anyway)
+        entry_location location { std::filesystem::path { parent_path } / rendered_name };
+        bool has_separator = rendered_name.find('/') != std::string::npos;
+        if (parent_fd != entry_location::no_descriptor && !rendered_name.empty() && !has_separator) {
+            location.directory_fd = parent_fd;
+            location.relative_offset = location.path.size() - rendered_name.size();
+        } else if (has_separator && entry.kind != file_kind::directory) {
+            auto parent_location = entry_location { std::filesystem::path { location.path }.parent_path().string() };
+            if (auto result = os::create_directory(parent_location); result.has_value())
+                record_error(result.value());
+        }
+        result.push_back(std::move(location));
+    }
+    return result;
+}
+
+void project_instantiator::record_error(std::string error) {
+    // only the first error is reported, all remaining work is skipped after it
+    std::lock_guard lock { m_error_mutex };
+    if (!m_error.has_value())
+        m_error = std::move(error);
+    m_failed = true;
+}
+
+} // namespace lppm
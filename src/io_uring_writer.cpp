@@ -0,0 +1,303 @@
+#include <lppm/io_uring_writer.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/os.h>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace lppm {
+
+#if defined(__linux__)
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, void* argument, unsigned argument_count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, argument, argument_count));
+}
+
+// checks whether the kernel supports all the operations used by the writer
+static bool are_operations_supported(int ring_fd) {
+    static constexpr unsigned probed_operations = IORING_OP_LAST;
+    std::vector<u8> probe_storage(sizeof(io_uring_probe) + probed_operations * sizeof(io_uring_probe_op));
+    auto probe = reinterpret_cast<io_uring_probe*>(probe_storage.data());
+    if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, probed_operations) < 0)
+        return false;
+
+    for (auto operation : { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+        if (operation > probe->last_op || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED))
+            return false;
+    }
+    return true;
+}
+
+std::unique_ptr<io_uring_writer> io_uring_writer::create() {
+    std::unique_ptr<io_uring_writer> writer { new io_uring_writer {} };
+
+    // create the ring, it may be missing (old kernels) or forbidden (seccomp, io_uring_disabled sysctl)
+    io_uring_params params {};
+    writer->m_ring_fd = io_uring_setup(ring_entries, &params);
+    if (writer->m_ring_fd < 0 || !(params.features & IORING_FEAT_NODROP))
+        return nullptr;
+    if (!are_operations_supported(writer->m_ring_fd))
+        return nullptr;
+
+    // map submission and completion rings (as a single mapping, if the kernel supports it) and submission entries
+    writer->m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    writer->m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mapping = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mapping)
+        writer->m_sq_ring_size = writer->m_cq_ring_size = std::max(writer->m_sq_ring_size, writer->m_cq_ring_size);
+
+    writer->m_sq_ring = mmap(nullptr, writer->m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             writer->m_ring_fd, IORING_OFF_SQ_RING);
+    if (writer->m_sq_ring == MAP_FAILED) {
+        writer->m_sq_ring = nullptr;
+        return nullptr;
+    }
+    if (single_mapping) {
+        writer->m_cq_ring = writer->m_sq_ring;
+    } else {
+        writer->m_cq_ring = mmap(nullptr, writer->m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 writer->m_ring_fd, IORING_OFF_CQ_RING);
+        if (writer->m_cq_ring == MAP_FAILED) {
+            writer->m_cq_ring = nullptr;
+            return nullptr;
+        }
+    }
+    writer->m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, writer->m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      writer->m_ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return nullptr;
+    writer->m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+    // resolve pointers to the ring fields
+    auto sq_base = static_cast<u8*>(writer->m_sq_ring);
+    auto cq_base = static_cast<u8*>(writer->m_cq_ring);
+    writer->m_sq_head = reinterpret_cast<unsigned*>(sq_base + params.sq_off.head);
+    writer->m_sq_tail = reinterpret_cast<unsigned*>(sq_base + params.sq_off.tail);
+    writer->m_sq_mask = reinterpret_cast<unsigned*>(sq_base + params.sq_off.ring_mask);
+    writer->m_sq_array = reinterpret_cast<unsigned*>(sq_base + params.sq_off.array);
+    writer->m_cq_head = reinterpret_cast<unsigned*>(cq_base + params.cq_off.head);
+    writer->m_cq_tail = reinterpret_cast<unsigned*>(cq_base + params.cq_off.tail);
+    writer->m_cq_mask = reinterpret_cast<unsigned*>(cq_base + params.cq_off.ring_mask);
+    writer->m_cqes = reinterpret_cast<io_uring_cqe*>(cq_base + params.cq_off.cqes);
+
+    return writer;
+}
+
+io_uring_writer::~io_uring_writer() { release_ring(); }
+
+io_uring_sqe* io_uring_writer::next_sqe() {
+    // the ring is always drained before submitting more entries, so it cannot overflow
+    unsigned tail = *m_sq_tail;
+    unsigned index = tail & *m_sq_mask;
+    io_uring_sqe* sqe = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    m_sq_array[index] = index;
+    __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+bool io_uring_writer::submit_and_wait(unsigned submitted, unsigned wait_for) {
+    while (submitted > 0 || wait_for > 0) {
+        int result = io_uring_enter(m_ring_fd, submitted, wait_for, IORING_ENTER_GETEVENTS);
+        m_stats.submissions++;
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0)
+            return false;
+
+        // all submitted entries are consumed at once, completions are awaited until all of them arrive
+        auto consumed = std::min<unsigned>(submitted, result);
+        m_in_flight += consumed;
+        submitted -= consumed;
+        unsigned available = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE) - *m_cq_head;
+        wait_for = available >= wait_for ? 0 : wait_for;
+    }
+    return true;
+}
+
+template <typename Callback>
+void io_uring_writer::reap_completions(Callback&& callback) {
+    unsigned head = *m_cq_head;
+    unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        auto& cqe = m_cqes[head & *m_cq_mask];
+        callback(cqe.user_data, cqe.res);
+        m_in_flight--;
+    }
+    __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+}
+
+io_uring_writer::write_result io_uring_writer::write_files(std::vector<pending_write>& files) {
+    write_result result {};
+    if (!m_is_usable) {
+        for (usz index = 0; index < files.size(); index++)
+            result.failed_files.push_back(index);
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> descriptors(files.size(), -1);
+    usz count = std::min(files.size(), max_batch_size);
+    for (usz index = count; index < files.size(); index++)
+        result.failed_files.push_back(index);
+
+    // open all files with a single submission, relative to their directories if there are descriptors of them
+    for (usz index = 0; index < count; index++) {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_OPENAT;
+        auto& location = files[index].location;
+        sqe->fd = location.directory_fd == entry_location::no_descriptor ? AT_FDCWD : location.directory_fd;
+        sqe->addr = reinterpret_cast<u64>(location.relative_path());
+        sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        sqe->len = 0666;
+        sqe->user_data = index;
+    }
+    if (!submit_and_wait(count, count)) {
+        // files opened by the submitted entries are closed as their completions arrive, nothing was written yet
+        bool drained = abandon(files, count, [](u64, i32 opened) {
+            if (opened >= 0)
+                close(opened);
+        });
+        for (usz index = 0; index < count; index++)
+            (drained ? result.failed_files : result.lost_files).push_back(index);
+        return result;
+    }
+    reap_completions([&](u64 user_data, i32 opened) { descriptors[user_data] = opened; });
+
+    // write and close all opened files with another one - closing is hard-linked, so it happens even if writing fails
+    unsigned submitted = 0;
+    std::vector<bool> written(count, false);
+    std::vector<bool> closed(count, false);
+    for (usz index = 0; index < count; index++) {
+        if (descriptors[index] < 0) {
+            result.failed_files.push_back(index);
+            continue;
+        }
+
+        auto write_sqe = next_sqe();
+        write_sqe->opcode = IORING_OP_WRITE;
+        write_sqe->fd = descriptors[index];
+        write_sqe->addr = reinterpret_cast<u64>(files[index].contents.data());
+        write_sqe->len = static_cast<u32>(files[index].contents.size());
+        write_sqe->off = 0;
+        write_sqe->flags = IOSQE_IO_HARDLINK;
+        write_sqe->user_data = index * 2;
+
+        auto close_sqe = next_sqe();
+        close_sqe->opcode = IORING_OP_CLOSE;
+        close_sqe->fd = descriptors[index];
+        close_sqe->user_data = index * 2 + 1;
+        submitted += 2;
+    }
+    auto on_completion = [&](u64 user_data, i32 completed) {
+        usz index = user_data / 2;
+        if (user_data % 2 == 1)
+            closed[index] = true;
+        else if (completed >= 0 && static_cast<usz>(completed) == files[index].contents.size())
+            written[index] = true;
+    };
+    if (submitted != 0 && !submit_and_wait(submitted, submitted)) {
+        // descriptors of entries that were never run are closed here, once it is certain nothing uses them anymore
+        bool drained = abandon(files, count, on_completion);
+        for (usz index = 0; index < count; index++) {
+            if (descriptors[index] < 0)
+                continue;
+            if (drained && !closed[index])
+                close(descriptors[index]);
+            (drained ? result.failed_files : result.lost_files).push_back(index);
+        }
+        return result;
+    }
+    reap_completions(on_completion);
+    for (usz index = 0; index < count; index++) {
+        if (descriptors[index] >= 0 && !written[index])
+            result.failed_files.push_back(index);
+    }
+
+    m_stats.batches++;
+    m_stats.files_written += count - result.failed_files.size() + (files.size() - count);
+    m_stats.batch_nanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+template <typename Callback>
+bool io_uring_writer::abandon(std::vector<pending_write>& files, usz count, Callback&& callback) {
+    // the writer is not used anymore - all requests still in flight are waited for, so none of them touches the files
+    // after they are given back, and completions of this batch are never mistaken for the ones of another batch
+    m_is_usable = false;
+    bool drained = true;
+    while (m_in_flight > 0) {
+        reap_completions(callback);
+        if (m_in_flight == 0)
+            break;
+        if (io_uring_enter(m_ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN &&
+            errno != EBUSY) {
+            drained = false;
+            break;
+        }
+    }
+
+    // if the ring cannot even be waited on, writes from the contents of the batch may still be running, so the contents
+    // are kept until the writer is destroyed, and the files cannot be written again
+    if (!drained) {
+        for (usz index = 0; index < count; index++)
+            m_lost_contents.push_back(std::move(files[index].contents));
+    }
+    release_ring();
+    return drained;
+}
+
+void io_uring_writer::release_ring() {
+    if (m_sqes != nullptr)
+        munmap(m_sqes, m_sqes_size);
+    if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring)
+        munmap(m_cq_ring, m_cq_ring_size);
+    if (m_sq_ring != nullptr)
+        munmap(m_sq_ring, m_sq_ring_size);
+    if (m_ring_fd >= 0)
+        close(m_ring_fd);
+    m_sqes = nullptr;
+    m_cq_ring = nullptr;
+    m_sq_ring = nullptr;
+    m_ring_fd = -1;
+}
+#else
+std::unique_ptr<io_uring_writer> io_uring_writer::create() { return nullptr; }
+
+io_uring_writer::~io_uring_writer() {}
+
+io_uring_writer::write_result io_uring_writer::write_files(std::vector<pending_write>& files) {
+    write_result result {};
+    for (usz index = 0; index < files.size(); index++)
+        result.failed_files.push_back(index);
+    return result;
+}
+#endif
+
+bool io_uring_writer::is_usable() const { return m_is_usable; }
+
+const io_uring_writer::statistics& io_uring_writer::stats() const { return m_stats; }
+
+} // namespace lppm
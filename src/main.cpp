@@ -13,7 +13,9 @@
 #include <lppm/globals.h>
 #include <lppm/handlers.h>
 #include <lppm/operation.h>
+#include <lppm/options.h>
 #include <lppm/os.h>
+#include <lppm/profiler.h>
 
 static std::map<std::string, lppm::operation> lppm_operations = {
     { "globals",
@@ -31,6 +33,11 @@ static std::map<std::string, lppm::operation> lppm_operations = {
               { { "name", true } },
               "unsets the value for replacement variable given by name" } },
           { "list", { lppm::handlers::globals_list_handler, {}, "lists all currently set replacement variables" } },
+          { "import",
+            { lppm::handlers::globals_import_handler,
+              { { "file", true } },
+              "sets all replacement variables listed in the file at once, one <name>:<value> entry per line (the "
+              "same format as the globals config file)" } },
           { "init",
             { lppm::handlers::globals_init_handler,
               {},
@@ -53,6 +60,11 @@ static std::map<std::string, lppm::operation> lppm_operations = {
               { lppm::handlers::project_init_handler,
                 { { "template name", true }, { "target directory", true } },
                 "make a project in specified target directory, by using a template with given name" } },
+            { "create-many",
+              { lppm::handlers::project_create_many_handler,
+                { { "manifest", true } },
+                "create all projects listed in the manifest file from a single template at once - the template is "
+                "read only once and its files are rendered into all targets concurrently" } },
         },
         "allows creation of new projects using saved templates" } },
     { "template",
@@ -77,6 +89,27 @@ static std::map<std::string, lppm::operation> lppm_operations = {
               "show information regarding template with given name" } },
           { "remove",
             { lppm::handlers::template_remove_handler, { { "name", true } }, "remove a template with given name" } },
+          { "pack",
+            { lppm::handlers::template_pack_handler,
+              { { "name", true } },
+              "stores the template with given name in a single " STYLE_GREEN ".lppmpack" STYLE_COLOR_RESET
+              " file instead of a directory, so creating projects from it reads just one file - packed templates "
+              "are used (and modified) just like the other ones" } },
+          { "unpack",
+            { lppm::handlers::template_unpack_handler,
+              { { "name", true } },
+              "turns the packed template with given name back into a directory, so its files can be edited" } },
+          { "gc",
+            { lppm::handlers::template_gc_handler,
+              {},
+              "removes files from the shared template store which are not used by any template anymore - files "
+              "used only by a template are removed along with it, this only cleans up after interrupted operations" } },
+          { "timeout",
+            { lppm::handlers::template_timeout_handler,
+              { { "name", true }, { "duration", false } },
+              "limits the time all commands of the template may take together (in seconds, or with s, m, h or d "
+              "suffix) - when the limit is exceeded, the commands are terminated - without duration, the limit is "
+              "removed" } },
           { "cmd",
             { {
                   { "add",
@@ -89,18 +122,77 @@ static std::map<std::string, lppm::operation> lppm_operations = {
                       { { "name", true }, { "command index", true } },
                       "removes a command at specified index from the template with given name - index of command can "
                       "be obtained by running" STYLE_GREEN " lppm template cmd list" STYLE_COLOR_RESET } },
+                  { "after",
+                    { lppm::handlers::template_cmd_after_handler,
+                      { { "template name", true }, { "command index", true }, { "dependency indices", false } },
+                      "makes a command wait only for the commands with given indices (comma-separated, all of them "
+                      "lower than the index of the command) - without any, the command starts right away, while "
+                      "commands without declared dependencies wait for the previous one - independent commands run "
+                      "in parallel, with their output captured and without access to the terminal (so they cannot be "
+                      "interactive), while commands run one after another share the terminal with lppm" } },
+                  { "limit",
+                    { lppm::handlers::template_cmd_limit_handler,
+                      { { "template name", true }, { "command index", true }, { "limit", true }, { "value", false } },
+                      "limits a command - timeout (wall time, in seconds or with s, m, h or d suffix), cpu (processor "
+                      "time, in the same units) or memory (address space, in bytes or with K, M, G or T suffix) - "
+                      "commands exceeding a limit are terminated (killed, if they do not exit within "
+                      "5 seconds) - without value, the limit is removed" } },
+                  { "directory",
+                    { lppm::handlers::template_cmd_directory_handler,
+                      { { "template name", true }, { "command index", true }, { "directory", false } },
+                      "makes a command run in the given directory, relative to the created project (variables are "
+                      "substituted in it) - without directory, the command runs in the project directory" } },
                   { "list",
                     { lppm::handlers::template_cmd_list_handler,
                       { { "name", true } },
                       "lists all commands to be run after creating a project using the specified template" } },
               },
-              "allows management of template commands that will be run at the location of created project" } } },
+              "allows management of template commands that will be run at the location of created project" } },
+          { "rule",
+            { {
+                  { "add",
+                    { lppm::handlers::template_rule_add_handler,
+                      { { "template name", true }, { "action", true }, { "pattern", true } },
+                      "adds a rule for template paths matching a glob pattern - render (always render the file, even "
+                      "if it looks binary), copy (copy the file without substitutions), skip (leave the file or "
+                      "directory out) or executable (make the created file executable) - patterns containing a slash "
+                      "are matched from the template root, other ones match any file or directory name" } },
+                  { "remove",
+                    { lppm::handlers::template_rule_remove_handler,
+                      { { "template name", true }, { "rule index", true } },
+                      "removes a rule at specified index from the template with given name - index of rule can be "
+                      "obtained by running" STYLE_GREEN " lppm template rule list" STYLE_COLOR_RESET } },
+                  { "list",
+                    { lppm::handlers::template_rule_list_handler,
+                      { { "template name", true } },
+                      "lists path rules of the template with given name, in the order they are applied" } },
+              },
+              "allows management of rules deciding how template files are instantiated" } },
+          { "default",
+            { {
+                  { "set",
+                    { lppm::handlers::template_default_set_handler,
+                      { { "template name", true }, { "variable name", true }, { "value", false } },
+                      "sets the default value of a variable for projects created from the template - it takes "
+                      "precedence over globals and the environment, but not over values given on the command line "
+                      "or by the project - without value, the default is removed" } },
+                  { "list",
+                    { lppm::handlers::template_default_list_handler,
+                      { { "template name", true } },
+                      "lists default values of variables declared by the template with given name" } },
+              },
+              "allows management of default values of template variables" } } },
         "allows managing saved templates" } },
 };
 
 static void print_usage_header() {
     std::cout << STYLE_GREEN "lppm (lifelessPixels' Project Maker) version 1.0\n" STYLE_RESET;
-    std::cout << "usage: " STYLE_BLUE "lppm <operation...>" STYLE_YELLOW " [arguments...]\n\n" STYLE_RESET;
+    std::cout << "usage: " STYLE_BLUE "lppm [options...] <operation...>" STYLE_YELLOW " [arguments...]\n\n" STYLE_RESET;
+    std::cout << STYLE_GREEN "available options:\n" STYLE_RESET;
+    for (auto& option : lppm::options::descriptions())
+        std::cout << std::format(STYLE_BLUE "{}" STYLE_RESET " " STYLE_ITALIC "- {}" STYLE_RESET "\n", option.usage,
+                                 option.description);
+    std::cout << "\n";
 }
 
 static void print_usage_for(const std::string& operation_name, const lppm::operation& op,
@@ -231,7 +323,28 @@ int main(int argc, char** argv) {
     arguments.reserve(argc - 1);
     arguments.assign(argv + 1, argv + argc);
 
+    // extract global options
+    auto options_result = lppm::options::the().parse_arguments(arguments);
+    if (options_result.has_value()) {
+        print_usage();
+        lppm::print_fatal(options_result.value());
+        return EXIT_FAILURE;
+    }
+
+    // profile the operation if asked to
+    auto& options = lppm::options::the();
+    if (options.should_print_stats() || options.trace_path().has_value())
+        lppm::profiler::the().enable();
+
     // try to run operation to known operations
     bool operation_result = run_operation(arguments, lppm_operations, "lppm ");
+    if (options.should_print_stats())
+        lppm::profiler::the().print_summary();
+    if (options.trace_path().has_value()) {
+        if (auto result = lppm::profiler::the().write_trace(options.trace_path().value()); result.has_value()) {
+            lppm::print_error(result.value());
+            return EXIT_FAILURE;
+        }
+    }
     return operation_result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,185 @@
+#include <lppm/options.h>
+
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <lppm/common.h>
+#include <lppm/globals.h>
+#include <lppm/os.h>
+#include <lppm/utils.h>
+
+namespace lppm {
+
+options& options::the() {
+    if (!s_the)
+        s_the = new options {};
+    return *s_the;
+}
+
+const std::vector<option_description>& options::descriptions() {
+    static const std::vector<option_description> result {
+        { "-j, --jobs <count>",
+          "number of worker threads used to create projects, defaults to the number of available CPUs" },
+        { "--io-backend <auto|io_uring|sync>",
+          "how rendered files are written - io_uring batches small files into few system calls, defaults to auto "
+          "(io_uring when the kernel supports it)" },
+        { "--stats", "print how long every phase of the operation took and how much work was done in it" },
+        { "--trace-json <file>",
+          "write timings of all phases, threads and template commands into the file, in the Chrome trace event "
+          "format (which can be opened in Perfetto)" },
+        { "-D <name>=<value>",
+          "set the value of a variable, overriding its value from any other source - may be given many times" },
+        { "--vars-file <file>",
+          "set values of variables listed in the file, one <name>:<value> entry per line - values given with -D "
+          "take precedence, later files override earlier ones (variables are also read from LPPM_VAR_<name> "
+          "environment variables, with the lowest precedence)" },
+        { "--non-interactive",
+          "never ask anything - missing variable values and confirmations are reported as errors" },
+        { "-y, --yes", "answer all confirmations with yes, implies --non-interactive" },
+        { "--", "treat all following arguments as operation arguments, even if they start with a dash" },
+    };
+    return result;
+}
+
+std::optional<std::string> options::parse_arguments(std::vector<std::string>& arguments) {
+    std::vector<std::string> remaining_arguments {};
+    remaining_arguments.reserve(arguments.size());
+    // variables from files are applied first, so values given with -D override them regardless of the order
+    std::map<std::string, std::string> command_line_variables {};
+
+    for (usz index = 0; index < arguments.size(); index++) {
+        auto& argument = arguments[index];
+
+        // everything after "--" is passed to the operation as-is
+        if (argument == "--") {
+            remaining_arguments.insert(remaining_arguments.end(), arguments.begin() + index + 1, arguments.end());
+            break;
+        }
+
+        // options end with the operation name - it and all arguments after it are passed to the operation as-is, so
+        // the operation arguments may start with a dash too
+        if (!argument.starts_with("-") || argument == "-") {
+            remaining_arguments.insert(remaining_arguments.end(), arguments.begin() + index, arguments.end());
+            break;
+        }
+
+        // split option name and its value (given either as "--name=value" or as the next argument)
+        std::string name { argument };
+        std::optional<std::string> inline_value {};
+        if (auto equals_position = argument.find('='); argument.starts_with("--") && equals_position != argument.npos) {
+            name = argument.substr(0, equals_position);
+            inline_value = argument.substr(equals_position + 1);
+        }
+        auto take_value = [&]() -> std::optional<std::string> {
+            if (inline_value.has_value())
+                return inline_value;
+            if (index + 1 >= arguments.size())
+                return {};
+            return arguments[++index];
+        };
+
+        if (name == "-j" || name == "--jobs") {
+            auto value = take_value();
+            if (!value.has_value())
+                return std::format("option `{}` requires a value", name);
+            try {
+                usz parsed_length = 0;
+                auto job_count = std::stoll(value.value(), &parsed_length);
+                if (parsed_length != value->size() || job_count <= 0)
+                    throw std::invalid_argument { "job count" };
+                m_job_count = static_cast<usz>(job_count);
+            } catch (...) {
+                return std::format("`{}` is not a valid job count", value.value());
+            }
+            continue;
+        }
+
+        if (name == "--io-backend") {
+            auto value = take_value();
+            if (!value.has_value())
+                return std::format("option `{}` requires a value", name);
+            if (value.value() == "auto")
+                m_io_backend = io_backend_kind::automatic;
+            else if (value.value() == "io_uring")
+                m_io_backend = io_backend_kind::io_uring;
+            else if (value.value() == "sync")
+                m_io_backend = io_backend_kind::synchronous;
+            else
+                return std::format("`{}` is not a valid I/O backend (expected auto, io_uring or sync)", value.value());
+            continue;
+        }
+
+        if (name.starts_with("-D")) {
+            auto value = name == "-D" ? take_value() : std::optional<std::string> { argument.substr(2) };
+            if (!value.has_value())
+                return std::format("option `{}` requires a value", name);
+            auto equals_position = value->find('=');
+            auto variable_name = trim_string(value->substr(0, equals_position));
+            if (equals_position == std::string::npos || variable_name.empty())
+                return std::format("`{}` is not a valid variable definition (expected <name>=<value>)", value.value());
+            command_line_variables.insert_or_assign(std::move(variable_name),
+                                                    trim_string(value->substr(equals_position + 1)));
+            continue;
+        }
+
+        if (name == "--vars-file") {
+            auto value = take_value();
+            if (!value.has_value())
+                return std::format("option `{}` requires a value", name);
+            auto maybe_entries = globals::read_entries_file(value.value());
+            if (std::holds_alternative<std::string>(maybe_entries))
+                return std::get<std::string>(maybe_entries);
+            for (auto& [variable_name, variable_value] : std::get<std::vector<globals::entry>>(maybe_entries))
+                m_variables.insert_or_assign(std::move(variable_name), std::move(variable_value));
+            continue;
+        }
+
+        if (name == "--non-interactive" && !inline_value.has_value()) {
+            if (m_prompts == prompt_policy::interactive)
+                m_prompts = prompt_policy::non_interactive;
+            continue;
+        }
+
+        if ((name == "-y" || name == "--yes") && !inline_value.has_value()) {
+            m_prompts = prompt_policy::assume_yes;
+            continue;
+        }
+
+        if (name == "--stats" && !inline_value.has_value()) {
+            m_should_print_stats = true;
+            continue;
+        }
+
+        if (name == "--trace-json") {
+            m_trace_path = take_value();
+            if (!m_trace_path.has_value())
+                return std::format("option `{}` requires a value", name);
+            continue;
+        }
+
+        return std::format("unknown option `{}`", argument);
+    }
+
+    for (auto& [variable_name, value] : command_line_variables)
+        m_variables.insert_or_assign(variable_name, std::move(value));
+    arguments = std::move(remaining_arguments);
+    return {};
+}
+
+usz options::job_count() const { return m_job_count != 0 ? m_job_count : os::available_cpu_count(); }
+
+io_backend_kind options::io_backend() const { return m_io_backend; }
+
+bool options::should_print_stats() const { return m_should_print_stats; }
+
+const std::optional<std::string>& options::trace_path() const { return m_trace_path; }
+
+prompt_policy options::prompts() const { return m_prompts; }
+
+const std::map<std::string, std::string>& options::variables() const { return m_variables; }
+
+} // namespace lppm
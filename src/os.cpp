@@ -1,15 +1,39 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string_view>
 #include <system_error>
+#include <thread>
+#include <variant>
+#include <vector>
 
 #include <lppm/cli.h>
+#include <lppm/common.h>
 #include <lppm/os.h>
 
 #if defined(__linux__)
+#include <fcntl.h>
+#include <linux/fs.h>
 #include <linux/limits.h>
 #include <pwd.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
@@ -46,12 +70,6 @@ std::string os::get_lppm_config_directory() {
 
 std::string os::get_working_directory() { return std::filesystem::current_path(); }
 
-bool os::set_working_directory(const std::string& new_wd) {
-    std::error_code code {};
-    std::filesystem::current_path(new_wd, code);
-    return !static_cast<bool>(code);
-}
-
 void os::ensure_directory_exists(const std::string& path) {
     // if it is a directory, just resturn
     if (std::error_code code; std::filesystem::is_directory(path, code))
@@ -70,6 +88,590 @@ void os::ensure_directory_exists(const std::string& path) {
         std::format("cannot create mandatory directory `{}` - file with that name already exists", path));
 }
 
-int os::run_command(const std::string& command) { return std::system(command.c_str()); }
+#if defined(__linux__)
+// splits a command into arguments if it can be executed without a shell - that is, if it is a list of plain words,
+// without quoting, expansions, redirections, operators or shell builtins
+static std::optional<std::vector<std::string>> split_simple_command(const std::string& command) {
+    static constexpr std::string_view shell_characters = "|&;<>()$`\\\"'*?[]{}#~=%!\n";
+    static constexpr std::string_view shell_builtins[] = {
+        ".", "alias", "bg", "break", "case", "cd", "command", "continue", "do", "done", "elif", "else", "esac", "eval",
+        "exec", "exit", "export", "fc", "fg", "fi", "for", "getopts", "hash", "if", "jobs", "local", "read", "readonly",
+        "return", "set", "shift", "source", "then", "times", "trap", "type", "ulimit", "umask", "unalias", "unset",
+        "until", "wait", "while",
+    };
+    if (command.find_first_of(shell_characters) != std::string::npos)
+        return {};
+
+    std::vector<std::string> arguments {};
+    for (usz start = command.find_first_not_of(" \t"); start != std::string::npos;) {
+        usz end = std::min(command.find_first_of(" \t", start), command.size());
+        arguments.push_back(command.substr(start, end - start));
+        start = command.find_first_not_of(" \t", end);
+    }
+    if (arguments.empty() || std::ranges::find(shell_builtins, arguments.front()) != std::end(shell_builtins))
+        return {};
+    return arguments;
+}
+
+// posix_spawn offers no way to set resource limits in the child before exec, so commands with limits are started
+// with fork, setting up the child the same way posix_spawn does - returns zero or an error number, like posix_spawn
+static int fork_with_limits(pid_t& pid, const std::vector<char*>& arguments, bool through_shell,
+                            const std::string& working_directory, command_output output, int output_fd,
+                            const resource_limits& limits) {
+    pid = fork();
+    if (pid < 0)
+        return errno;
+    if (pid != 0) {
+        setpgid(pid, pid);
+        return 0;
+    }
+
+    // only async-signal-safe functions may be called in the child before exec - the processor time limit gets
+    // a margin, so the command receives SIGXCPU first and is killed a second later
+    if (limits.cpu_seconds.has_value()) {
+        rlimit limit { static_cast<rlim_t>(limits.cpu_seconds.value()),
+                       static_cast<rlim_t>(limits.cpu_seconds.value() + 1) };
+        if (setrlimit(RLIMIT_CPU, &limit) != 0)
+            _exit(127);
+    }
+    if (limits.memory_bytes.has_value()) {
+        rlimit limit { static_cast<rlim_t>(limits.memory_bytes.value()),
+                       static_cast<rlim_t>(limits.memory_bytes.value()) };
+        if (setrlimit(RLIMIT_AS, &limit) != 0)
+            _exit(127);
+    }
+    if (setpgid(0, 0) != 0)
+        _exit(127);
+    if (output == command_output::captured) {
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd < 0 || dup2(null_fd, STDIN_FILENO) < 0 || dup2(output_fd, STDOUT_FILENO) < 0 ||
+            dup2(output_fd, STDERR_FILENO) < 0)
+            _exit(127);
+    }
+    sigset_t empty_mask {};
+    sigemptyset(&empty_mask);
+    if (sigprocmask(SIG_SETMASK, &empty_mask, nullptr) != 0 || chdir(working_directory.c_str()) != 0)
+        _exit(127);
+
+    if (through_shell)
+        execv("/bin/sh", arguments.data());
+    else
+        execvp(arguments[0], arguments.data());
+    _exit(127);
+}
+
+// makes the process group the foreground one of the terminal - lppm may be in the background while doing so (when it
+// takes the terminal back), so SIGTTOU is blocked, as it would stop lppm otherwise
+static void set_terminal_group(pid_t group) {
+    sigset_t terminal_output {};
+    sigset_t previous_mask {};
+    sigemptyset(&terminal_output);
+    sigaddset(&terminal_output, SIGTTOU);
+    pthread_sigmask(SIG_BLOCK, &terminal_output, &previous_mask);
+    tcsetpgrp(STDIN_FILENO, group);
+    pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+}
+
+std::variant<std::string, child_process> os::start_command(const std::string& command,
+                                                           const std::string& working_directory,
+                                                           command_output output, const resource_limits& limits) {
+    // the pipe is not inherited by other children of lppm - it may still be inherited by whatever the child starts, so
+    // its end of file does not mean the child has exited
+    int pipe_fds[2] { -1, -1 };
+    if (output == command_output::captured && pipe2(pipe_fds, O_CLOEXEC) != 0)
+        return std::format("could not create a pipe for command `{}` - {}", command, std::strerror(errno));
+    auto close_pipe = [&] {
+        for (int fd : pipe_fds) {
+            if (fd >= 0)
+                close(fd);
+        }
+    };
+
+    // the child always gets its own process group, so it can be terminated together with everything it started -
+    // with captured output, it does not read from the terminal, the working directory is changed only in the child
+    posix_spawn_file_actions_t file_actions {};
+    posix_spawnattr_t attributes {};
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawnattr_init(&attributes);
+    sigset_t empty_mask {};
+    sigemptyset(&empty_mask);
+    posix_spawnattr_setsigmask(&attributes, &empty_mask);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP;
+    posix_spawnattr_setpgroup(&attributes, 0);
+    if (output == command_output::captured) {
+        posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], STDERR_FILENO);
+    }
+    posix_spawnattr_setflags(&attributes, flags);
+    posix_spawn_file_actions_addchdir_np(&file_actions, working_directory.c_str());
+
+    // plain commands are executed directly (looked up in PATH), everything else is interpreted by the shell
+    auto simple_arguments = split_simple_command(command);
+    std::vector<std::string> arguments = simple_arguments.has_value()
+                                             ? std::move(simple_arguments.value())
+                                             : std::vector<std::string> { "sh", "-c", command };
+    std::vector<char*> argument_pointers {};
+    for (auto& argument : arguments)
+        argument_pointers.push_back(argument.data());
+    argument_pointers.push_back(nullptr);
+
+    std::cout.flush();
+    pid_t pid = -1;
+    int result = 0;
+    if (!limits.cpu_seconds.has_value() && !limits.memory_bytes.has_value()) {
+        result = simple_arguments.has_value() ? posix_spawnp(&pid, argument_pointers[0], &file_actions, &attributes,
+                                                             argument_pointers.data(), environ)
+                                              : posix_spawn(&pid, "/bin/sh", &file_actions, &attributes,
+                                                            argument_pointers.data(), environ);
+    } else {
+        result = fork_with_limits(pid, argument_pointers, !simple_arguments.has_value(), working_directory, output,
+                                  pipe_fds[1], limits);
+    }
+    auto start_time = std::chrono::steady_clock::now();
+    posix_spawn_file_actions_destroy(&file_actions);
+    posix_spawnattr_destroy(&attributes);
+    if (result != 0) {
+        close_pipe();
+        return std::format("could not start command `{}` - {}", command, std::strerror(result));
+    }
+
+    if (pipe_fds[1] >= 0)
+        close(pipe_fds[1]);
+
+    // a child sharing the terminal gets it while it runs, like a foreground job of a shell - if it tried to use the
+    // terminal before getting it, it was stopped, so it is continued
+    bool has_terminal = output == command_output::inherited && isatty(STDIN_FILENO) &&
+                        tcgetpgrp(STDIN_FILENO) == getpgrp();
+    if (has_terminal) {
+        set_terminal_group(pid);
+        kill(-pid, SIGCONT);
+    }
+
+    // the pidfd lets the caller wait for the exit of the child together with its output (it is close-on-exec already)
+    int pid_fd = -1;
+#if defined(SYS_pidfd_open)
+    pid_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#endif
+    return child_process { pid, output, pipe_fds[0], pid_fd, has_terminal, start_time };
+}
+
+std::variant<std::string, command_result> os::run_command(const std::string& command,
+                                                          const std::string& working_directory,
+                                                          command_output output) {
+    auto started = start_command(command, working_directory, output);
+    if (std::holds_alternative<std::string>(started))
+        return std::get<std::string>(started);
+    auto& child = std::get<child_process>(started);
+
+    // read the whole output before waiting for the child, so it never blocks on a full pipe
+    std::string captured_output {};
+    if (child.output_fd >= 0) {
+        c8 buffer[64 * 1024];
+        ssize_t read_size = 0;
+        while ((read_size = read(child.output_fd, buffer, sizeof(buffer))) != 0) {
+            if (read_size < 0 && errno == EINTR)
+                continue;
+            if (read_size < 0)
+                break;
+            captured_output.append(buffer, static_cast<usz>(read_size));
+        }
+        close(child.output_fd);
+    }
+
+    auto result = wait_for_child(child);
+    result.output = std::move(captured_output);
+    return result;
+}
+
+static command_result result_of_child(const child_process& child, int status) {
+    if (child.pid_fd >= 0)
+        close(child.pid_fd);
+    if (child.has_terminal)
+        set_terminal_group(getpgrp());
+
+    command_result result {};
+    result.wall_time = std::chrono::steady_clock::now() - child.start_time;
+    if (WIFSIGNALED(status)) {
+        result.signal = WTERMSIG(status);
+        result.exit_code = 128 + WTERMSIG(status);
+    } else {
+        result.exit_code = WEXITSTATUS(status);
+    }
+    return result;
+}
+
+command_result os::wait_for_child(const child_process& child) {
+    int status = 0;
+    while (waitpid(child.pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            print_internal_error_and_exit(std::format("could not wait for a child process {} - {}", child.pid,
+                                                      std::strerror(errno)));
+    }
+    return result_of_child(child, status);
+}
+
+std::optional<command_result> os::try_wait_for_child(const child_process& child) {
+    int status = 0;
+    pid_t waited = -1;
+    while ((waited = waitpid(child.pid, &status, WNOHANG)) < 0) {
+        if (errno != EINTR)
+            print_internal_error_and_exit(std::format("could not wait for a child process {} - {}", child.pid,
+                                                      std::strerror(errno)));
+    }
+    if (waited == 0)
+        return {};
+    return result_of_child(child, status);
+}
+
+void os::terminate_child(const child_process& child) { kill(-child.pid, SIGTERM); }
+
+void os::kill_child(const child_process& child) { kill(-child.pid, SIGKILL); }
+#endif
+
+#if defined(__linux__)
+// returns the number of CPUs the cgroup quota allows to use, or zero if there is no quota
+static usz get_cgroup_cpu_limit() {
+    auto limit_from_quota = [](double quota, double period) -> usz {
+        if (quota <= 0 || period <= 0)
+            return 0;
+        return std::max<usz>(1, static_cast<usz>(quota / period + 0.999));
+    };
+
+    // cgroup v2 - the process cgroup is given by "0::<path>" line, quota is stored in cpu.max of it and its parents
+    std::filesystem::path cgroup_root { "/sys/fs/cgroup" };
+    std::ifstream cgroup_file { "/proc/self/cgroup" };
+    for (std::string line {}; std::getline(cgroup_file, line);) {
+        if (!line.starts_with("0::"))
+            continue;
+
+        // the most restrictive quota on the path from the root to the process cgroup applies
+        usz limit = 0;
+        auto cgroup_path = cgroup_root;
+        auto check_cpu_max = [&] {
+            std::ifstream cpu_max_file { cgroup_path / "cpu.max" };
+            std::string quota {};
+            double period = 0;
+            if (cpu_max_file >> quota >> period && quota != "max") {
+                usz current = limit_from_quota(std::atof(quota.c_str()), period);
+                if (current != 0 && (limit == 0 || current < limit))
+                    limit = current;
+            }
+        };
+        check_cpu_max();
+        for (auto& component : std::filesystem::path { line.substr(3) }.relative_path()) {
+            if (component.empty())
+                continue;
+            cgroup_path /= component;
+            check_cpu_max();
+        }
+        return limit;
+    }
+
+    // cgroup v1 - quota is stored in two separate files of the cpu controller
+    std::ifstream quota_file { "/sys/fs/cgroup/cpu/cpu.cfs_quota_us" };
+    std::ifstream period_file { "/sys/fs/cgroup/cpu/cpu.cfs_period_us" };
+    double quota = 0;
+    double period = 0;
+    if (quota_file >> quota && period_file >> period)
+        return limit_from_quota(quota, period);
+    return 0;
+}
+#endif
+
+usz os::available_cpu_count() {
+    static const usz cpu_count = [] {
+        usz count = std::thread::hardware_concurrency();
+#if defined(__linux__)
+        // honour CPU affinity mask (taskset, cpusets) and cgroup CPU quota (containers, CI runners)
+        if (cpu_set_t cpu_set; sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+            count = CPU_COUNT(&cpu_set);
+        if (usz limit = get_cgroup_cpu_limit(); limit != 0)
+            count = std::min(count, limit);
+#endif
+        return std::max<usz>(count, 1);
+    }();
+    return cpu_count;
+}
+
+#if defined(__linux__)
+process_usage os::current_process_usage() {
+    process_usage result {};
+
+    // I/O accounting of the whole process (all threads), lines like "syscr: 123"
+    std::ifstream io_file { "/proc/self/io" };
+    for (std::string name {}, value {}; io_file >> name >> value;) {
+        u64* target = name == "syscr:"   ? &result.read_calls
+                      : name == "syscw:" ? &result.write_calls
+                      : name == "rchar:" ? &result.read_bytes
+                      : name == "wchar:" ? &result.written_bytes
+                                         : nullptr;
+        if (target != nullptr)
+            *target = std::strtoull(value.c_str(), nullptr, 10);
+    }
+
+    // maximal resident set sizes are reported in kilobytes
+    if (struct rusage usage {}; getrusage(RUSAGE_SELF, &usage) == 0)
+        result.peak_resident_bytes = static_cast<u64>(usage.ru_maxrss) * 1024;
+    if (struct rusage usage {}; getrusage(RUSAGE_CHILDREN, &usage) == 0)
+        result.children_peak_resident_bytes = static_cast<u64>(usage.ru_maxrss) * 1024;
+    return result;
+}
+#else
+process_usage os::current_process_usage() { return {}; }
+#endif
+
+#if defined(__linux__)
+// copies a byte range between file descriptors without passing it through user space if possible - it tries
+// copy_file_range first, then sendfile and falls back to pread/pwrite if neither of them is supported
+static bool copy_file_range_between(int source_fd, int target_fd, off_t offset, off_t length) {
+    // copy_file_range may share extents or do a server-side copy on some filesystems
+    off_t source_offset = offset;
+    off_t target_offset = offset;
+    while (length > 0) {
+        ssize_t copied = copy_file_range(source_fd, &source_offset, target_fd, &target_offset, length, 0);
+        if (copied == 0)
+            errno = EINVAL;
+        if (copied <= 0)
+            break;
+        length -= copied;
+    }
+    if (length == 0)
+        return true;
+    if (errno != EXDEV && errno != ENOSYS && errno != EOPNOTSUPP && errno != EINVAL)
+        return false;
+
+    // sendfile writes at the current position of the target file
+    if (lseek(target_fd, target_offset, SEEK_SET) < 0)
+        return false;
+    while (length > 0) {
+        ssize_t copied = sendfile(target_fd, source_fd, &source_offset, length);
+        if (copied == 0)
+            errno = EINVAL;
+        if (copied <= 0)
+            break;
+        target_offset += copied;
+        length -= copied;
+    }
+    if (length == 0)
+        return true;
+    if (errno != ENOSYS && errno != EINVAL)
+        return false;
+
+    // plain copy as the last resort
+    std::vector<c8> buffer(std::min<off_t>(length, 1024 * 1024));
+    while (length > 0) {
+        ssize_t read_count = pread(source_fd, buffer.data(), std::min<off_t>(length, buffer.size()), source_offset);
+        if (read_count == 0)
+            errno = EIO;
+        if (read_count <= 0)
+            return false;
+        for (ssize_t written = 0; written < read_count;) {
+            ssize_t current = pwrite(target_fd, buffer.data() + written, read_count - written, target_offset);
+            if (current < 0)
+                return false;
+            written += current;
+            target_offset += current;
+        }
+        source_offset += read_count;
+        length -= read_count;
+    }
+    return true;
+}
+
+static std::optional<std::string> copy_file_contents(int source_fd, int target_fd, const struct stat& source_stat) {
+    // try to make a reflink first (btrfs, xfs...) - no data is copied at all in this case
+    if (ioctl(target_fd, FICLONE, source_fd) == 0)
+        return {};
+
+    // files with fewer allocated blocks than their size have holes - copy only the data regions of such files
+    off_t size = source_stat.st_size;
+    bool may_be_sparse = source_stat.st_blocks * 512 < size;
+    for (off_t offset = 0; offset < size;) {
+        off_t data_start = may_be_sparse ? lseek(source_fd, offset, SEEK_DATA) : offset;
+        if (data_start < 0 && errno == ENXIO)
+            break;
+        if (data_start < 0) {
+            // SEEK_DATA is not supported by the filesystem, just copy everything
+            may_be_sparse = false;
+            continue;
+        }
+        off_t data_end = may_be_sparse ? lseek(source_fd, data_start, SEEK_HOLE) : size;
+        if (data_end < 0)
+            data_end = size;
+
+        if (!copy_file_range_between(source_fd, target_fd, data_start, data_end - data_start))
+            return std::strerror(errno);
+        offset = data_end;
+    }
+
+    // extend the file in case it ends with a hole
+    if (ftruncate(target_fd, size) != 0)
+        return std::strerror(errno);
+    return {};
+}
+
+static int at_descriptor(const entry_location& location) {
+    return location.directory_fd == entry_location::no_descriptor ? AT_FDCWD : location.directory_fd;
+}
+
+int os::open_file(const entry_location& location) {
+    int flags = O_RDONLY | O_CLOEXEC | (location.follows_link ? 0 : O_NOFOLLOW);
+    return openat(at_descriptor(location), location.relative_path(), flags);
+}
+
+std::optional<std::string> os::copy_file(const entry_location& source, const entry_location& target) {
+    // both files are opened relative to their directories, if there are descriptors of them
+    auto& source_path = source.path;
+    auto& target_path = target.path;
+    int source_fd = open_file(source);
+    if (source_fd < 0)
+        return std::format("could not open file `{}` for reading - {}", source_path, std::strerror(errno));
+
+    struct stat source_stat {};
+    if (fstat(source_fd, &source_stat) != 0) {
+        close(source_fd);
+        return std::format("could not read attributes of file `{}` - {}", source_path, std::strerror(errno));
+    }
+
+    int target_fd = openat(at_descriptor(target), target.relative_path(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                           0666);
+    if (target_fd < 0) {
+        close(source_fd);
+        return std::format("could not create a file `{}` - {}", target_path, std::strerror(errno));
+    }
+
+    auto result = copy_file_contents(source_fd, target_fd, source_stat);
+    close(source_fd);
+    if (close(target_fd) != 0 && !result.has_value())
+        result = std::strerror(errno);
+
+    if (result.has_value())
+        return std::format("could not copy file `{}` to `{}` - {}", source_path, target_path, result.value());
+    return {};
+}
+#else
+std::optional<std::string> os::copy_file(const entry_location& source, const entry_location& target) {
+    std::error_code code {};
+    std::filesystem::copy_file(source.path, target.path, std::filesystem::copy_options::overwrite_existing, code);
+    if (code)
+        return std::format("could not copy file `{}` to `{}` - {}", source.path, target.path, code.message());
+    return {};
+}
+#endif
+
+static std::optional<std::string> create_directories(const std::string& path) {
+    std::error_code code {};
+    std::filesystem::create_directories(path, code);
+    if (code)
+        return std::format("could not create a directory `{}` - {}", path, code.message());
+    return {};
+}
+
+#if defined(__linux__)
+int os::open_directory(const entry_location& location) {
+    // the descriptor is only used as a base of other paths, so it does not need to allow reading
+    int directory_fd = openat(at_descriptor(location), location.relative_path(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    return directory_fd < 0 ? entry_location::no_descriptor : directory_fd;
+}
+
+void os::close_directory(int directory_fd) {
+    if (directory_fd != entry_location::no_descriptor)
+        close(directory_fd);
+}
+
+std::optional<std::string> os::create_directory(const entry_location& location) {
+    if (location.directory_fd == entry_location::no_descriptor)
+        return create_directories(location.path);
+    if (mkdirat(location.directory_fd, location.relative_path(), 0777) == 0)
+        return {};
+
+    int error = errno;
+    struct stat existing_stat {};
+    if (error == EEXIST && fstatat(location.directory_fd, location.relative_path(), &existing_stat, 0) == 0 &&
+        S_ISDIR(existing_stat.st_mode))
+        return {};
+    return std::format("could not create a directory `{}` - {}", location.path, std::strerror(error));
+}
+
+std::optional<std::string> os::write_file(const entry_location& location, std::string_view contents) {
+    int fd = openat(at_descriptor(location), location.relative_path(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        return std::format("could not create a file `{}` - {}", location.path, std::strerror(errno));
+
+    while (!contents.empty()) {
+        auto written = write(fd, contents.data(), contents.size());
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            auto error = written < 0 ? std::strerror(errno) : "no space left";
+            close(fd);
+            return std::format("could not write a file `{}` - {}", location.path, error);
+        }
+        contents.remove_prefix(static_cast<usz>(written));
+    }
+    if (close(fd) != 0)
+        return std::format("could not write a file `{}` - {}", location.path, std::strerror(errno));
+    return {};
+}
+
+std::optional<std::string> os::make_executable(const entry_location& location) {
+    struct stat file_stat {};
+    if (fstatat(at_descriptor(location), location.relative_path(), &file_stat, 0) == 0) {
+        auto mode = file_stat.st_mode & 07777;
+        if ((mode & S_IRUSR) != 0)
+            mode |= S_IXUSR;
+        if ((mode & S_IRGRP) != 0)
+            mode |= S_IXGRP;
+        if ((mode & S_IROTH) != 0)
+            mode |= S_IXOTH;
+        if (fchmodat(at_descriptor(location), location.relative_path(), mode, 0) == 0)
+            return {};
+    }
+    return std::format("could not make a file `{}` executable - {}", location.path, std::strerror(errno));
+}
+#else
+int os::open_directory(const entry_location&) { return entry_location::no_descriptor; }
+
+int os::open_file(const entry_location&) {
+    errno = ENOSYS;
+    return -1;
+}
+
+void os::close_directory(int) {}
+
+std::optional<std::string> os::create_directory(const entry_location& location) {
+    return create_directories(location.path);
+}
+
+std::optional<std::string> os::write_file(const entry_location& location, std::string_view contents) {
+    std::ofstream resulting_file { location.path, std::ios::binary };
+    if (!resulting_file)
+        return std::format("could not create a file `{}` - {}", location.path, std::strerror(errno));
+    resulting_file.write(contents.data(), contents.size());
+    if (!resulting_file.flush())
+        return std::format("could not write a file `{}`", location.path);
+    return {};
+}
+
+std::optional<std::string> os::make_executable(const entry_location& location) {
+    using std::filesystem::perms;
+    std::error_code code {};
+    auto permissions = std::filesystem::status(location.path, code).permissions();
+    if (!code) {
+        auto added = perms::none;
+        if ((permissions & perms::owner_read) != perms::none)
+            added |= perms::owner_exec;
+        if ((permissions & perms::group_read) != perms::none)
+            added |= perms::group_exec;
+        if ((permissions & perms::others_read) != perms::none)
+            added |= perms::others_exec;
+        std::filesystem::permissions(location.path, added, std::filesystem::perm_options::add, code);
+    }
+    if (code)
+        return std::format("could not make a file `{}` executable - {}", location.path, code.message());
+    return {};
+}
+#endif
 
 } // namespace lppm
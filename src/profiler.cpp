@@ -0,0 +1,248 @@
+#include <lppm/profiler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lppm/cli.h>
+#include <lppm/common.h>
+#include <lppm/os.h>
+
+namespace lppm {
+
+// track ids of template commands in the trace, far away from the ones of the threads
+static constexpr usz command_track_base = 1000;
+
+static constexpr std::string_view counter_names[profiler::counter_count] = {
+    "entries walked",      "files scanned",     "bytes scanned",  "files read",     "bytes read",
+    "markers substituted", "names substituted", "files rendered", "bytes rendered", "files copied",
+    "bytes copied",        "directories created", "commands run",
+};
+
+static double to_milliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static void append_json_string(std::string& output, std::string_view text) {
+    output += '"';
+    for (c8 character : text) {
+        switch (character) {
+            case '"':
+                output += "\\\"";
+                break;
+            case '\\':
+                output += "\\\\";
+                break;
+            case '\n':
+                output += "\\n";
+                break;
+            case '\t':
+                output += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(character) < 0x20)
+                    output += std::format("\\u{:04x}", static_cast<unsigned>(character));
+                else
+                    output += character;
+                break;
+        }
+    }
+    output += '"';
+}
+
+profiler& profiler::the() {
+    if (!s_the)
+        s_the = new profiler {};
+    return *s_the;
+}
+
+void profiler::enable() {
+    if (is_enabled())
+        return;
+
+    // the enabling thread becomes the first track of the trace
+    m_start_time = clock::now();
+    m_start_usage = os::current_process_usage();
+    current_thread_spans();
+    m_enabled.store(true, std::memory_order_relaxed);
+}
+
+profiler::thread_spans& profiler::current_thread_spans() {
+    if (s_current_spans == nullptr) {
+        std::lock_guard lock { m_mutex };
+        m_threads.push_back(std::make_unique<thread_spans>(m_threads.size()));
+        s_current_spans = m_threads.back().get();
+    }
+    return *s_current_spans;
+}
+
+void profiler::record_span(std::string_view name, clock::time_point start, clock::time_point end,
+                           std::string_view detail) {
+    if (!is_enabled())
+        return;
+    current_thread_spans().spans.push_back({ name, std::string { detail }, start, end });
+}
+
+void profiler::record_command(usz index, std::string_view command, clock::time_point start,
+                              std::chrono::nanoseconds wall_time, int exit_code) {
+    if (!is_enabled())
+        return;
+    count(counter::commands_run);
+    std::lock_guard lock { m_mutex };
+    m_commands.push_back({ index, std::string { command }, start, wall_time, exit_code });
+}
+
+void profiler::print_summary() const {
+    if (!is_enabled())
+        return;
+    std::lock_guard lock { m_mutex };
+    auto usage = os::current_process_usage();
+
+    // spans with the same name are summed up, in order of their first appearance
+    struct span_totals {
+    public:
+        clock::time_point first_start;
+        usz count { 0 };
+        std::chrono::nanoseconds total {};
+        std::chrono::nanoseconds longest {};
+    };
+    std::map<std::string_view, span_totals> totals {};
+    for (auto& thread : m_threads) {
+        for (auto& current : thread->spans) {
+            auto [iterator, inserted] = totals.try_emplace(current.name, current.start);
+            auto& entry = iterator->second;
+            entry.first_start = std::min(entry.first_start, current.start);
+            entry.count++;
+            entry.total += current.end - current.start;
+            entry.longest = std::max<std::chrono::nanoseconds>(entry.longest, current.end - current.start);
+        }
+    }
+    std::vector<std::pair<std::string_view, span_totals>> ordered { totals.begin(), totals.end() };
+    std::ranges::sort(ordered, {}, [](auto& entry) { return entry.second.first_start; });
+
+    print_unformatted_line(std::format(STYLE_BLUE "stats" STYLE_RESET " ({} thread(s), {:.2f} ms in total):",
+                                       m_threads.size(), to_milliseconds(clock::now() - m_start_time)));
+    print_unformatted_line("  spans (summed up over all threads):");
+    for (auto& [name, entry] : ordered) {
+        print_unformatted_line(std::format("    {:<20} {:>10.2f} ms  {:>7} time(s), longest {:.2f} ms", name,
+                                           to_milliseconds(entry.total), entry.count,
+                                           to_milliseconds(entry.longest)));
+    }
+
+    print_unformatted_line("  counters:");
+    for (usz index = 0; index < counter_count; index++) {
+        if (auto value = m_counters[index].load(std::memory_order_relaxed); value != 0)
+            print_unformatted_line(std::format("    {:<20} {:>10}", counter_names[index], value));
+    }
+    print_unformatted_line(
+        std::format("    {:<20} {:>10}", "read syscalls", usage.read_calls - m_start_usage.read_calls));
+    print_unformatted_line(
+        std::format("    {:<20} {:>10}", "write syscalls", usage.write_calls - m_start_usage.write_calls));
+    print_unformatted_line(
+        std::format("    {:<20} {:>10}", "bytes written", usage.written_bytes - m_start_usage.written_bytes));
+    print_unformatted_line(std::format("    {:<20} {:>10.1f} MiB", "peak RSS",
+                                       static_cast<double>(usage.peak_resident_bytes) / (1024.0 * 1024.0)));
+    if (usage.children_peak_resident_bytes != 0) {
+        print_unformatted_line(std::format("    {:<20} {:>10.1f} MiB", "peak RSS of commands",
+                                           static_cast<double>(usage.children_peak_resident_bytes) /
+                                               (1024.0 * 1024.0)));
+    }
+
+    if (m_commands.empty())
+        return;
+    print_unformatted_line("  commands:");
+    for (auto& command : m_commands) {
+        print_unformatted_line(std::format("    " STYLE_BLUE "[{}]" STYLE_RESET " {:>10.2f} ms  exit code {}  {}",
+                                           command.index, to_milliseconds(command.wall_time), command.exit_code,
+                                           command.command));
+    }
+}
+
+std::optional<std::string> profiler::write_trace(const std::string& path) const {
+    if (!is_enabled())
+        return {};
+    std::lock_guard lock { m_mutex };
+
+    // timestamps are in microseconds since the profiler was enabled
+    auto microseconds = [this](clock::time_point point) {
+        return std::chrono::duration<double, std::micro>(point - m_start_time).count();
+    };
+    std::string json { "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n" };
+    json += "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"lppm\"}}";
+    auto add_track_name = [&](usz track, std::string_view name) {
+        json += std::format(",\n{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {}, \"args\": "
+                            "{{\"name\": ",
+                            track);
+        append_json_string(json, name);
+        json += "}}";
+    };
+
+    for (auto& thread : m_threads) {
+        add_track_name(thread->thread_index,
+                       thread->thread_index == 0 ? "main" : std::format("thread {}", thread->thread_index));
+        for (auto& current : thread->spans) {
+            json += ",\n{\"name\": ";
+            append_json_string(json, current.name);
+            json += std::format(", \"cat\": \"lppm\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, "
+                                "\"dur\": {:.3f}",
+                                thread->thread_index, microseconds(current.start),
+                                microseconds(current.end) - microseconds(current.start));
+            if (!current.detail.empty()) {
+                json += ", \"args\": {\"detail\": ";
+                append_json_string(json, current.detail);
+                json += "}";
+            }
+            json += "}";
+        }
+    }
+
+    // every command gets its own track, as commands run in parallel while being waited for by a single thread
+    for (auto& command : m_commands) {
+        usz track = command_track_base + command.index;
+        add_track_name(track, std::format("command {}", command.index));
+        json += ",\n{\"name\": ";
+        append_json_string(json, command.command);
+        json += std::format(", \"cat\": \"command\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, "
+                            "\"dur\": {:.3f}, \"args\": {{\"exit_code\": {}}}}}",
+                            track, microseconds(command.start),
+                            std::chrono::duration<double, std::micro>(command.wall_time).count(), command.exit_code);
+    }
+
+    // counters are shown as a single sample at the end of the trace
+    json += std::format(",\n{{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": {:.3f}, \"args\": {{",
+                        microseconds(clock::now()));
+    for (usz index = 0; index < counter_count; index++) {
+        if (index != 0)
+            json += ", ";
+        append_json_string(json, counter_names[index]);
+        json += std::format(": {}", m_counters[index].load(std::memory_order_relaxed));
+    }
+    json += "}}\n]}\n";
+
+    std::ofstream file { path, std::ios::binary };
+    if (!file || !file.write(json.data(), static_cast<std::streamsize>(json.size())) || !file.flush())
+        return std::format("cannot write trace file `{}`", path);
+    return {};
+}
+
+profile_span::profile_span(std::string_view name, std::string_view detail) : m_name(name) {
+    if (!profiler::the().is_enabled())
+        return;
+    m_detail = detail;
+    m_start = profiler::clock::now();
+}
+
+profile_span::~profile_span() {
+    if (m_start.has_value())
+        profiler::the().record_span(m_name, m_start.value(), profiler::clock::now(), m_detail);
+}
+
+} // namespace lppm
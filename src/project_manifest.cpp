@@ -0,0 +1,96 @@
+#include <lppm/project_manifest.h>
+
+#include <filesystem>
+#include <format>
+#include <set>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include <lppm/common.h>
+#include <lppm/file_contents.h>
+#include <lppm/utils.h>
+
+namespace lppm {
+
+static std::string_view take_line(std::string_view& contents) {
+    auto line_end = contents.find('\n');
+    auto line = contents.substr(0, line_end);
+    contents.remove_prefix(line_end == std::string_view::npos ? contents.size() : line_end + 1);
+    if (line.ends_with('\r'))
+        line.remove_suffix(1);
+    return line;
+}
+
+std::variant<std::string, project_manifest> project_manifest::parse_from_file(const std::string& path) {
+    auto contents = file_contents::read(path);
+    if (std::holds_alternative<std::string>(contents))
+        return std::format("cannot open file `{}` for reading", path);
+    return parse_from_text(std::get<file_contents>(contents).view(), path);
+}
+
+std::variant<std::string, project_manifest> project_manifest::parse_from_text(std::string_view contents,
+                                                                              const std::string& path) {
+    if (trim_string_view(take_line(contents)) != header_string_v1)
+        return std::format("header contained in file `{}` is invalid for current lppm version", path);
+
+    project_manifest result {};
+    std::set<std::string> target_paths {};
+    usz line_number = 1;
+    auto line_error = [&](std::string_view message) {
+        return std::format("line {} in file `{}` is invalid - {}", line_number, path, message);
+    };
+
+    while (!contents.empty()) {
+        auto line = trim_string_view(take_line(contents));
+        line_number++;
+        if (line.empty() || line.starts_with('#'))
+            continue;
+
+        // every project section starts a new project - two projects cannot be created in the same directory
+        if (line.starts_with('[')) {
+            static constexpr std::string_view project_prefix = "[project ";
+            if (!line.starts_with(project_prefix) || !line.ends_with(']'))
+                return line_error(std::format("unknown section `{}`", line));
+            auto name_length = line.size() - project_prefix.size() - 1;
+            auto target_path = std::string { trim_string_view(line.substr(project_prefix.size(), name_length)) };
+            if (target_path.empty())
+                return line_error("target directory of the project is missing");
+            if (!target_paths.insert(std::filesystem::absolute(target_path).lexically_normal()).second)
+                return line_error(std::format("project at `{}` is listed more than once", target_path));
+            result.m_projects.push_back({ std::move(target_path) });
+            continue;
+        }
+
+        // before the first project, only the template can be given
+        if (result.m_projects.empty()) {
+            static constexpr std::string_view template_prefix = "template ";
+            if (!line.starts_with(template_prefix))
+                return line_error("expected `template <name>` or a project section");
+            result.m_template_name = trim_string_view(line.substr(template_prefix.size()));
+            continue;
+        }
+
+        // variables are given like in the globals file
+        auto colon_position = line.find(':');
+        if (colon_position == std::string_view::npos)
+            return line_error("expected `<variable name>: <value>`");
+        auto name = trim_string_view(line.substr(0, colon_position));
+        if (name.empty())
+            return line_error("variable name is missing");
+        auto value = trim_string_view(line.substr(colon_position + 1));
+        result.m_projects.back().variables.insert_or_assign(std::string { name }, std::string { value });
+    }
+
+    if (result.m_template_name.empty())
+        return std::format("file `{}` does not name a template to create the projects from", path);
+    if (result.m_projects.empty())
+        return std::format("file `{}` does not list any projects", path);
+    return result;
+}
+
+const std::string& project_manifest::template_name() const { return m_template_name; }
+
+const std::vector<project_manifest::project>& project_manifest::projects() const { return m_projects; }
+
+} // namespace lppm
@@ -0,0 +1,154 @@
+#include <lppm/scanner.h>
+
+#include <cstring>
+#include <format>
+#include <string_view>
+#include <vector>
+
+#include <lppm/cli.h>
+#include <lppm/common.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define LPPM_HAS_X86_SCANNERS 1
+#endif
+
+namespace lppm {
+
+using marker_scanner_function = usz (*)(const c8* data, usz size, usz from);
+
+static usz find_marker_scalar(const c8* data, usz size, usz from) {
+    // look for every "@" with memchr and check whether it is followed by another one
+    usz index = from;
+    while (index + 1 < size) {
+        auto found = static_cast<const c8*>(std::memchr(data + index, '@', size - index - 1));
+        if (found == nullptr)
+            return std::string_view::npos;
+
+        index = found - data;
+        if (data[index + 1] == '@')
+            return index;
+        index += 2;
+    }
+
+    return std::string_view::npos;
+}
+
+#if defined(LPPM_HAS_X86_SCANNERS)
+static usz find_marker_sse2(const c8* data, usz size, usz from) {
+    // compare 16 bytes at a time with themselves shifted by one - a set bit in both masks is the start of "@@"
+    const __m128i at_signs = _mm_set1_epi8('@');
+    usz index = from;
+    while (index + 17 <= size) {
+        __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+        __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index + 1));
+        u32 mask = static_cast<u32>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(current, at_signs), _mm_cmpeq_epi8(next, at_signs))));
+        if (mask != 0)
+            return index + __builtin_ctz(mask);
+        index += 16;
+    }
+
+    // finish the tail that is too short for a full vector
+    return find_marker_scalar(data, size, index);
+}
+
+__attribute__((target("avx2"))) static usz find_marker_avx2(const c8* data, usz size, usz from) {
+    // same as the SSE2 scanner, but 32 bytes at a time
+    const __m256i at_signs = _mm256_set1_epi8('@');
+    usz index = from;
+    while (index + 33 <= size) {
+        __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+        __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index + 1));
+        u32 mask = static_cast<u32>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(current, at_signs), _mm256_cmpeq_epi8(next, at_signs))));
+        if (mask != 0)
+            return index + __builtin_ctz(mask);
+        index += 32;
+    }
+
+    // finish the tail with the narrower scanner
+    return find_marker_sse2(data, size, index);
+}
+#endif
+
+static bool is_marker_scanner_supported(marker_scanner_kind kind) {
+    switch (kind) {
+        case marker_scanner_kind::scalar:
+            return true;
+#if defined(LPPM_HAS_X86_SCANNERS)
+        case marker_scanner_kind::sse2:
+            return true;
+        case marker_scanner_kind::avx2:
+            return __builtin_cpu_supports("avx2");
+#else
+        case marker_scanner_kind::sse2:
+        case marker_scanner_kind::avx2:
+            return false;
+#endif
+    }
+    return false;
+}
+
+static marker_scanner_function marker_scanner_function_for(marker_scanner_kind kind) {
+    switch (kind) {
+        case marker_scanner_kind::scalar:
+            return find_marker_scalar;
+#if defined(LPPM_HAS_X86_SCANNERS)
+        case marker_scanner_kind::sse2:
+            return find_marker_sse2;
+        case marker_scanner_kind::avx2:
+            return find_marker_avx2;
+#else
+        case marker_scanner_kind::sse2:
+        case marker_scanner_kind::avx2:
+            break;
+#endif
+    }
+    print_internal_error_and_exit(
+        std::format("marker scanner `{}` is not available on this platform", marker_scanner_name(kind)));
+}
+
+marker_scanner_kind active_marker_scanner() {
+    static const marker_scanner_kind active = supported_marker_scanners().back();
+    return active;
+}
+
+std::vector<marker_scanner_kind> supported_marker_scanners() {
+    std::vector<marker_scanner_kind> result {};
+    for (auto kind : { marker_scanner_kind::scalar, marker_scanner_kind::sse2, marker_scanner_kind::avx2 }) {
+        if (is_marker_scanner_supported(kind))
+            result.push_back(kind);
+    }
+    return result;
+}
+
+const char* marker_scanner_name(marker_scanner_kind kind) {
+    switch (kind) {
+        case marker_scanner_kind::scalar:
+            return "scalar";
+        case marker_scanner_kind::sse2:
+            return "sse2";
+        case marker_scanner_kind::avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+usz find_marker(std::string_view text, usz from) {
+    static const marker_scanner_function active = marker_scanner_function_for(active_marker_scanner());
+    if (from >= text.size())
+        return std::string_view::npos;
+    return active(text.data(), text.size(), from);
+}
+
+usz find_marker_with(marker_scanner_kind kind, std::string_view text, usz from) {
+    if (!is_marker_scanner_supported(kind))
+        print_internal_error_and_exit(
+            std::format("marker scanner `{}` is not supported by this CPU", marker_scanner_name(kind)));
+    if (from >= text.size())
+        return std::string_view::npos;
+    return marker_scanner_function_for(kind)(text.data(), text.size(), from);
+}
+
+} // namespace lppm
@@ -0,0 +1,122 @@
+#include <lppm/sha256.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+static constexpr std::array<u32, 64> round_constants = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+sha256::sha256()
+    : m_state({ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }) {}
+
+void sha256::update(std::string_view data) {
+    auto bytes = reinterpret_cast<const u8*>(data.data());
+    usz size = data.size();
+    m_total_size += size;
+
+    // fill up the partial block first, then process whole blocks straight from the input
+    if (m_buffer_size != 0) {
+        usz taken = std::min(size, m_buffer.size() - m_buffer_size);
+        std::memcpy(m_buffer.data() + m_buffer_size, bytes, taken);
+        m_buffer_size += taken;
+        bytes += taken;
+        size -= taken;
+        if (m_buffer_size < m_buffer.size())
+            return;
+        process_block(m_buffer.data());
+        m_buffer_size = 0;
+    }
+    for (; size >= m_buffer.size(); bytes += m_buffer.size(), size -= m_buffer.size())
+        process_block(bytes);
+    std::memcpy(m_buffer.data(), bytes, size);
+    m_buffer_size = size;
+}
+
+std::array<u8, 32> sha256::finish() {
+    // pad with a single set bit and zeros, ending with the message length in bits
+    u64 bit_size = m_total_size * 8;
+    static constexpr u8 padding[64] = { 0x80 };
+    usz padding_size = m_buffer_size < 56 ? 56 - m_buffer_size : 120 - m_buffer_size;
+    update({ reinterpret_cast<const c8*>(padding), padding_size });
+    u8 length[8];
+    for (usz byte = 0; byte < 8; byte++)
+        length[byte] = static_cast<u8>(bit_size >> (56 - byte * 8));
+    update({ reinterpret_cast<const c8*>(length), sizeof(length) });
+
+    std::array<u8, 32> digest {};
+    for (usz word = 0; word < m_state.size(); word++) {
+        for (usz byte = 0; byte < 4; byte++)
+            digest[word * 4 + byte] = static_cast<u8>(m_state[word] >> (24 - byte * 8));
+    }
+    return digest;
+}
+
+std::string sha256::hex_digest(std::string_view data) {
+    static constexpr std::string_view digits = "0123456789abcdef";
+    sha256 hash {};
+    hash.update(data);
+    std::string result {};
+    for (auto byte : hash.finish()) {
+        result += digits[byte >> 4];
+        result += digits[byte & 0xf];
+    }
+    return result;
+}
+
+void sha256::process_block(const u8* block) {
+    std::array<u32, 64> schedule {};
+    for (usz word = 0; word < 16; word++) {
+        schedule[word] = static_cast<u32>(block[word * 4]) << 24 | static_cast<u32>(block[word * 4 + 1]) << 16 |
+                         static_cast<u32>(block[word * 4 + 2]) << 8 | static_cast<u32>(block[word * 4 + 3]);
+    }
+    for (usz word = 16; word < 64; word++) {
+        u32 s0 = std::rotr(schedule[word - 15], 7) ^ std::rotr(schedule[word - 15], 18) ^ (schedule[word - 15] >> 3);
+        u32 s1 = std::rotr(schedule[word - 2], 17) ^ std::rotr(schedule[word - 2], 19) ^ (schedule[word - 2] >> 10);
+        schedule[word] = schedule[word - 16] + s0 + schedule[word - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = m_state;
+    for (usz round = 0; round < 64; round++) {
+        u32 s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        u32 choice = (e & f) ^ (~e & g);
+        u32 first = h + s1 + choice + round_constants[round] + schedule[round];
+        u32 s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        u32 majority = (a & b) ^ (a & c) ^ (b & c);
+        u32 second = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + first;
+        d = c;
+        c = b;
+        b = a;
+        a = first + second;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+} // namespace lppm
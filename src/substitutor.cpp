@@ -1,49 +1,311 @@
 #include <lppm/substitutor.h>
 
+#include <algorithm>
 #include <format>
+#include <fstream>
+#include <ios>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
 
 #include <lppm/cli.h>
 #include <lppm/common.h>
+#include <lppm/scanner.h>
 
 namespace lppm {
 
-std::string do_the_substitutions(const std::string& text, std::map<std::string, std::string>& mappings) {
+compiled_text::compiled_text(std::string_view text) : m_text(text) {}
+
+compiled_text compiled_text::compile(std::string_view text) {
+    compiled_text result { text };
+    std::unordered_map<std::string_view, usz> variable_indices {};
+
     usz current_index = 0;
-    std::string result {};
     usz found_index = 0;
-    while ((found_index = text.find("@@", current_index)) != std::string::npos) {
+    while ((found_index = find_marker(text, current_index)) != std::string_view::npos) {
         // if we are here, the double "at" symbol was found at found_index
-        // firstly, copy the text up to this point to the result string
-        result += text.substr(current_index, found_index - current_index);
+        // firstly, record the text up to this point as a literal span
+        if (found_index != current_index)
+            result.m_segments.push_back({ current_index, found_index - current_index });
         current_index = found_index;
 
-        // find next occurence marking the end of substitution
+        // find next occurence marking the end of substitution, if there is none, the rest of the text is literal
         usz start_index = found_index + 2;
-        usz end_index = text.find("@@", found_index + 2);
-        if (end_index == std::string::npos)
+        usz end_index = find_marker(text, start_index);
+        if (end_index == std::string_view::npos)
             break;
 
-        // extract the substitution variable's name
-        std::string variable_name = text.substr(start_index, end_index - start_index);
+        // intern the variable name, so every distinct variable gets exactly one slot
+        auto variable_name = text.substr(start_index, end_index - start_index);
+        auto [iterator, inserted] = variable_indices.try_emplace(variable_name, result.m_variables.size());
+        if (inserted)
+            result.m_variables.emplace_back(variable_name);
 
-        // if variable does not exist in current mappings, ask user for the substitution
-        if (!mappings.contains(variable_name)) {
-            auto value = prompt_user_input(
-                std::format("enter substitution value for variable " STYLE_BLUE "@@{}@@" STYLE_RESET, variable_name));
-            mappings.insert_or_assign(variable_name, value);
-        }
-
-        // substitute the value and continue
-        result += mappings.at(variable_name);
+        // record the whole marker (including both "@@" delimiters) as a variable slot
+        result.m_segments.push_back({ found_index, end_index + 2 - found_index, iterator->second });
         current_index = end_index + 2;
     }
 
-    // no further occurences of "@@" were found, copy all text from current_index to the end of string to the result
-    result += text.substr(current_index);
+    // no further occurences of "@@" were found, the rest of the text is a literal span
+    if (current_index != text.size())
+        result.m_segments.push_back({ current_index, text.size() - current_index });
+
+    return result;
+}
+
+std::optional<compiled_text> compiled_text::from_markers(std::string_view text, const std::vector<segment>& markers,
+                                                         std::vector<std::string> variables) {
+    compiled_text result { text };
+    result.m_variables = std::move(variables);
+    result.m_segments.reserve(markers.size() * 2 + 1);
+
+    // rebuild literal spans between previously found markers, checking that the markers are still where they were
+    usz current_index = 0;
+    for (auto& marker : markers) {
+        if (marker.offset < current_index || marker.length < 4 || marker.offset + marker.length > text.size() ||
+            marker.variable_index >= result.m_variables.size() || text.substr(marker.offset, 2) != "@@" ||
+            text.substr(marker.offset + marker.length - 2, 2) != "@@")
+            return {};
+
+        if (marker.offset != current_index)
+            result.m_segments.push_back({ current_index, marker.offset - current_index });
+        result.m_segments.push_back(marker);
+        current_index = marker.offset + marker.length;
+    }
+    if (current_index != text.size())
+        result.m_segments.push_back({ current_index, text.size() - current_index });
+
+    return result;
+}
+
+std::string_view compiled_text::text() const { return m_text; }
+
+const std::vector<compiled_text::segment>& compiled_text::segments() const { return m_segments; }
+
+const std::vector<std::string>& compiled_text::variables() const { return m_variables; }
+
+bool compiled_text::has_markers() const { return !m_variables.empty(); }
+
+const std::string& resolve_variable(const std::string& variable_name, std::map<std::string, std::string>& mappings) {
+    auto iterator = mappings.find(variable_name);
+
+    // if variable does not exist in current mappings, ask user for the substitution
+    if (iterator == mappings.end()) {
+        auto value = prompt_user_input(
+            std::format("enter substitution value for variable " STYLE_BLUE "@@{}@@" STYLE_RESET, variable_name));
+        iterator = mappings.insert_or_assign(variable_name, value).first;
+    }
+
+    return iterator->second;
+}
+
+std::vector<const std::string*> compiled_text::resolve_values(const variable_resolver& resolver) const {
+    std::vector<const std::string*> values {};
+    values.reserve(m_variables.size());
+
+    // variables are stored in order of first appearance, so prompts are issued in the same order as before
+    for (auto& variable_name : m_variables)
+        values.push_back(&resolver(variable_name));
+
+    return values;
+}
+
+std::vector<const std::string*> compiled_text::resolve_values(std::map<std::string, std::string>& mappings) const {
+    return resolve_values([&](const std::string& variable_name) -> const std::string& {
+        return resolve_variable(variable_name, mappings);
+    });
+}
+
+std::string compiled_text::render(const std::vector<const std::string*>& values) const {
+    if (values.size() != m_variables.size())
+        print_internal_error_and_exit("compiled text rendered with mismatched variable values");
+
+    // compute the exact size of the output, so the result is allocated only once
+    usz result_size = 0;
+    for (auto& current : m_segments)
+        result_size += current.is_literal() ? current.length : values[current.variable_index]->size();
+
+    // concatenate literal spans and variable values
+    std::string result {};
+    result.reserve(result_size);
+    for (auto& current : m_segments) {
+        if (current.is_literal())
+            result.append(m_text.data() + current.offset, current.length);
+        else
+            result.append(*values[current.variable_index]);
+    }
 
-    // return fully substituted string
     return result;
 }
 
+std::string compiled_text::render(std::map<std::string, std::string>& mappings) const {
+    return render(resolve_values(mappings));
+}
+
+std::string do_the_substitutions(const std::string& text, std::map<std::string, std::string>& mappings) {
+    return compiled_text::compile(text).render(mappings);
+}
+
+std::string do_the_substitutions(const std::string& text, const variable_resolver& resolver) {
+    auto compiled = compiled_text::compile(text);
+    return compiled.render(compiled.resolve_values(resolver));
+}
+
+// reads the file in chunks and reports literal text and variable markers found in it, in order of appearance - if
+// on_literal is empty, the literal text is not reported at all
+static std::optional<std::string> walk_markers_in_chunks(const std::string& source_path, usz chunk_size,
+                                                         const std::function<void(std::string_view)>& on_literal,
+                                                         const std::function<void(const std::string&)>& on_variable) {
+    std::ifstream source { source_path, std::ios::binary };
+    if (!source)
+        return std::format("could not open file `{}` for reading", source_path);
+    // the window holds the bytes that were read, but not yet written - outside of a marker it is at most a single
+    // trailing "@", inside of a marker it is the opening "@@" followed by the variable name read so far
+    std::string window {};
+    window.reserve(chunk_size + max_streamed_variable_name_length + 4);
+    auto write_literal = [&](usz offset, usz length) {
+        if (on_literal && length != 0)
+            on_literal(std::string_view { window.data() + offset, length });
+    };
+    usz window_offset = 0;
+    bool inside_marker = false;
+    usz closing_search_index = 0;
+
+    // when a variable name grows too long, it is not buffered anymore - the opening marker offset is remembered
+    // instead, so the text can be re-read if it turns out that the marker is never closed
+    bool name_overflowed = false;
+    usz overflowed_marker_offset = 0;
+
+    for (bool end_of_file = false; !end_of_file;) {
+        // append next chunk to the window
+        usz previous_size = window.size();
+        window.resize(previous_size + chunk_size);
+        source.read(window.data() + previous_size, static_cast<std::streamsize>(chunk_size));
+        window.resize(previous_size + static_cast<usz>(source.gcount()));
+        end_of_file = !source;
+        if (end_of_file && !source.eof())
+            return std::format("could not read contents of file `{}`", source_path);
+
+        if (name_overflowed) {
+            // only look for the closing marker, keeping the last byte in case it is a half of "@@"
+            if (find_marker(window) != std::string_view::npos) {
+                return std::format("variable name starting at offset {} in file `{}` is longer than {} bytes",
+                                   overflowed_marker_offset, source_path, max_streamed_variable_name_length);
+            }
+            usz kept = !window.empty() && window.back() == '@' ? 1 : 0;
+            window_offset += window.size() - kept;
+            window.erase(0, window.size() - kept);
+            continue;
+        }
+
+        usz current_index = 0;
+        while (true) {
+            if (!inside_marker) {
+                // look for an opening marker, write everything before it
+                usz found_index = find_marker(window, current_index);
+                if (found_index == std::string_view::npos) {
+                    usz kept = !end_of_file && window.size() > current_index && window.back() == '@' ? 1 : 0;
+                    write_literal(current_index, window.size() - kept - current_index);
+                    current_index = window.size() - kept;
+                    break;
+                }
+                write_literal(current_index, found_index - current_index);
+                current_index = found_index;
+                closing_search_index = found_index + 2;
+                inside_marker = true;
+            }
+
+            // look for a closing marker, report the variable if it is found
+            usz end_index = find_marker(window, closing_search_index);
+            if (end_index != std::string_view::npos) {
+                on_variable(window.substr(current_index + 2, end_index - current_index - 2));
+                current_index = end_index + 2;
+                inside_marker = false;
+                continue;
+            }
+
+            // if the marker is never closed, the rest of the text is copied verbatim
+            if (end_of_file) {
+                write_literal(current_index, window.size() - current_index);
+                current_index = window.size();
+                break;
+            }
+
+            // otherwise wait for more data, the last byte is searched again in case it is a half of "@@"
+            closing_search_index = std::max(window.size(), current_index + 3) - 1;
+            if (window.size() - current_index - 2 > max_streamed_variable_name_length) {
+                name_overflowed = true;
+                overflowed_marker_offset = window_offset + current_index;
+                current_index = window.size() - (window.back() == '@' ? 1 : 0);
+            }
+            break;
+        }
+
+        // drop everything that was already consumed from the window
+        closing_search_index -= inside_marker && !name_overflowed ? current_index : 0;
+        window_offset += current_index;
+        window.erase(0, current_index);
+    }
+
+    // an overflowed marker was never closed - the text from the opening marker to the end of file is literal
+    if (name_overflowed && on_literal) {
+        source.clear();
+        source.seekg(static_cast<std::streamoff>(overflowed_marker_offset));
+        for (window.resize(chunk_size); source;) {
+            source.read(window.data(), static_cast<std::streamsize>(chunk_size));
+            write_literal(0, static_cast<usz>(source.gcount()));
+        }
+        if (!source.eof())
+            return std::format("could not read contents of file `{}`", source_path);
+    }
+
+    return {};
+}
+
+std::optional<std::string> stream_substitutions(const std::string& source_path, const std::string& target_path,
+                                                const variable_resolver& resolver, usz chunk_size) {
+    std::ofstream target { target_path, std::ios::binary };
+    if (!target)
+        return std::format("could not create a file `{}`", target_path);
+
+    // write literal text as-is and values of the variables in place of markers
+    auto result = walk_markers_in_chunks(
+        source_path, chunk_size,
+        [&](std::string_view literal) { target.write(literal.data(), static_cast<std::streamsize>(literal.size())); },
+        [&](const std::string& variable_name) {
+            auto& value = resolver(variable_name);
+            target.write(value.data(), static_cast<std::streamsize>(value.size()));
+        });
+    if (result.has_value())
+        return result;
+
+    target.flush();
+    if (!target)
+        return std::format("could not write a file `{}`", target_path);
+    return {};
+}
+
+std::variant<std::string, std::vector<std::string>> stream_variable_names(const std::string& source_path,
+                                                                         usz chunk_size) {
+    // collect unique variable names in order of first appearance
+    std::vector<std::string> variable_names {};
+    std::unordered_set<std::string> known_names {};
+    auto result = walk_markers_in_chunks(source_path, chunk_size, {}, [&](const std::string& variable_name) {
+        if (known_names.insert(variable_name).second)
+            variable_names.push_back(variable_name);
+    });
+    if (result.has_value())
+        return result.value();
+    return variable_names;
+}
+
+std::optional<std::string> stream_substitutions(const std::string& source_path, const std::string& target_path,
+                                                std::map<std::string, std::string>& mappings, usz chunk_size) {
+    auto resolver = [&](const std::string& variable_name) -> const std::string& {
+        return resolve_variable(variable_name, mappings);
+    };
+    return stream_substitutions(source_path, target_path, resolver, chunk_size);
+}
+
 } // namespace lppm
@@ -2,54 +2,82 @@
 
 #include <filesystem>
 #include <format>
+#include <memory>
+#include <optional>
+#include <string>
 #include <system_error>
 #include <variant>
+#include <vector>
 
+#include <lppm/blob_store.h>
 #include <lppm/cli.h>
+#include <lppm/ignore_matcher.h>
 #include <lppm/os.h>
+#include <lppm/profiler.h>
+#include <lppm/template_index.h>
 #include <lppm/template_info.h>
+#include <lppm/template_pack.h>
+#include <lppm/template_registry.h>
 
 namespace lppm {
 
-project_template::project_template(std::string base_directory, template_info info)
-    : m_base_directory(std::move(base_directory)), m_info(std::move(info)) {}
-
-std::map<std::string, project_template> project_template::get_all_templates() {
-    std::map<std::string, project_template> result {};
-
-    // check whether the "templates" directory exists
-    std::string templates_directory_path =
-        std::filesystem::path { os::get_lppm_config_directory() } / templates_directory_name;
-    if (std::error_code code; !std::filesystem::is_directory(templates_directory_path, code) || code)
-        return result;
-
-    // get all directories inside of templates directory and try to create templates from them
-    for (auto& directory_entry : std::filesystem::directory_iterator { templates_directory_path }) {
-        if (std::error_code code; !directory_entry.is_directory(code) || code)
-            continue;
-
-        // if we have a directory, try to load a template from it
-        auto maybe_template = template_from_directory(std::filesystem::absolute(directory_entry.path()));
-        if (std::holds_alternative<std::string>(maybe_template)) {
-            print_warning(std::format(
-                "error occurred while loading a list of available templates at template directory `{}` - {}",
-                static_cast<std::string>(directory_entry.path()), std::get<std::string>(maybe_template)));
+// copies the directory tree like std::filesystem::copy does, but without descending into ignored directories - regular
+// files (except for the template metadata) are added to the blob store and linked into the template, so files shared
+// by many templates are stored only once, and the manifest listing the blobs is written at the end
+static std::optional<std::string> copy_template_files(const std::string& source_directory,
+                                                      const std::string& target_directory) {
+    auto ignore = ignore_matcher::load(source_directory);
+    std::vector<blob_store::manifest_entry> manifest {};
+    std::error_code code {};
+    for (std::filesystem::recursive_directory_iterator iterator { source_directory, code }, end {};
+         !code && iterator != end; iterator.increment(code)) {
+        auto& directory_entry = *iterator;
+        auto relative_path = directory_entry.path().lexically_relative(source_directory);
+        auto target_path = std::filesystem::path { target_directory } / relative_path;
+
+        std::error_code type_code {};
+        bool is_directory = directory_entry.is_directory(type_code);
+        if (ignore.is_ignored(relative_path.generic_string(), is_directory)) {
+            if (is_directory)
+                iterator.disable_recursion_pending();
             continue;
         }
 
-        // add loaded template to the resulting map
-        result.insert_or_assign(directory_entry.path().filename(), std::get<project_template>(maybe_template));
+        if (is_directory) {
+            std::filesystem::create_directory(target_path, code);
+        } else if (directory_entry.is_regular_file(type_code) &&
+                   !template_index::is_template_metadata_file(directory_entry.path().filename())) {
+            auto stored = blob_store::add_file(directory_entry.path(), target_path, relative_path.generic_string());
+            if (std::holds_alternative<std::string>(stored))
+                return std::get<std::string>(stored);
+            manifest.push_back(std::move(std::get<blob_store::manifest_entry>(stored)));
+        } else {
+            std::filesystem::copy(directory_entry.path(), target_path, code);
+        }
+        if (code)
+            return std::format("cannot copy `{}` - {}", static_cast<std::string>(directory_entry.path()),
+                               code.message());
     }
-
-    // return collected project templates
-    return result;
+    if (code)
+        return code.message();
+    return blob_store::write_manifest(target_directory, manifest);
 }
 
+project_template::project_template(std::string base_directory, template_info info,
+                                   std::shared_ptr<template_pack> pack)
+    : m_base_directory(std::move(base_directory)), m_info(std::move(info)), m_pack(std::move(pack)) {}
+
 std::variant<std::string, project_template>
 project_template::template_from_directory(const std::string& directory_path) {
-    // check if directory even exists
-    if (std::error_code code; !std::filesystem::is_directory(directory_path, code) || code)
-        return std::format("cannot read template directory `{}`", directory_path);
+    profile_span span { "load template", directory_path };
+
+    // check if directory even exists, otherwise the template may be packed
+    if (std::error_code code; !std::filesystem::is_directory(directory_path, code) || code) {
+        auto pack_path = directory_path + template_pack::file_extension;
+        if (std::error_code code; !std::filesystem::is_regular_file(pack_path, code) || code)
+            return std::format("cannot read template directory `{}`", directory_path);
+        return template_from_pack(pack_path);
+    }
 
     // check if template info file exists
     std::string template_info_path = std::filesystem::path { directory_path } / template_info_file_name;
@@ -65,6 +93,20 @@ project_template::template_from_directory(const std::string& directory_path) {
     return project_template { std::filesystem::absolute(directory_path), std::get<template_info>(maybe_template_info) };
 }
 
+std::variant<std::string, project_template> project_template::template_from_pack(const std::string& pack_path) {
+    auto maybe_pack = template_pack::open(pack_path);
+    if (std::holds_alternative<std::string>(maybe_pack))
+        return std::get<std::string>(maybe_pack);
+    auto pack = std::make_shared<template_pack>(std::move(std::get<template_pack>(maybe_pack)));
+
+    // the info is stored inside of the pack
+    auto maybe_template_info = template_info::parse_from_text(pack->info_text(), pack_path);
+    if (std::holds_alternative<std::string>(maybe_template_info))
+        return std::get<std::string>(maybe_template_info);
+    return project_template { std::filesystem::absolute(pack_path), std::get<template_info>(maybe_template_info),
+                              std::move(pack) };
+}
+
 std::variant<std::string, project_template>
 project_template::create_new_template(std::string template_name, std::optional<std::string> maybe_source_directory,
                                       bool should_write_empty_info) {
@@ -72,10 +114,12 @@ project_template::create_new_template(std::string template_name, std::optional<s
     std::string projects_directory_path =
         std::filesystem::path { os::get_lppm_config_directory() } / templates_directory_name;
     os::ensure_directory_exists(projects_directory_path);
+    auto registry_time = template_registry::directory_time();
 
     // check whether project with the same name exists
     std::string maybe_template_path = std::filesystem::path { projects_directory_path } / template_name;
-    if (std::error_code code; std::filesystem::exists(maybe_template_path, code) || code) {
+    if (std::error_code code; std::filesystem::exists(maybe_template_path, code) || code ||
+                              std::filesystem::exists(maybe_template_path + template_pack::file_extension, code)) {
         return std::format(
             "tried to create a project template at path `{}`, but the file with this name already exists",
             maybe_template_path);
@@ -98,12 +142,12 @@ project_template::create_new_template(std::string template_name, std::optional<s
             return std::format("cannot access source directory for newly created project directory", source_directory);
         }
 
-        // recursively copy all the files from the source directory, to the new template directory
-        std::filesystem::copy(source_directory, template_path, std::filesystem::copy_options::recursive, code);
-        if (code) {
-            std::filesystem::remove_all(template_path, code);
-            return std::format("cannot copy files from source directory to newly created project directory",
-                               source_directory);
+        // recursively copy all the files from the source directory, to the new template directory - entries ignored
+        // by the .lppmignore file of the source directory (which itself is copied) are left out
+        if (auto result = copy_template_files(source_directory, template_path); result.has_value()) {
+            blob_store::remove_template_directory(template_path);
+            return std::format("cannot copy files from source directory `{}` to newly created project directory - {}",
+                               source_directory, result.value());
         }
     }
 
@@ -114,13 +158,23 @@ project_template::create_new_template(std::string template_name, std::optional<s
         std::string info_path = std::filesystem::path { template_path } / template_info_file_name;
         auto save_result = info.save_to_file(info_path);
         if (save_result.has_value()) {
-            std::filesystem::remove_all(template_path, code);
+            blob_store::remove_template_directory(template_path);
             return std::format("error occurred while writing a template info file `{}` - {}", info_path,
                                save_result.value());
         }
     }
 
+    // index the template files, so projects can be created without scanning them - the index is only a cache, so
+    // failing to write it is not fatal
+    auto maybe_index = template_index::build(template_path);
+    if (std::holds_alternative<std::string>(maybe_index)) {
+        print_warning(std::format("could not index template files - {}", std::get<std::string>(maybe_index)));
+    } else if (auto result = std::get<template_index>(maybe_index).save(template_path); result.has_value()) {
+        print_warning(std::format("could not write template index - {}", result.value()));
+    }
+
     // read the template in and return it
+    template_registry::update(template_name, registry_time);
     auto maybe_template = template_from_directory(template_path);
     if (std::holds_alternative<std::string>(maybe_template)) {
         print_internal_error_and_exit(
@@ -148,7 +202,28 @@ const std::string& project_template::base_directory() const { return m_base_dire
 
 const template_info& project_template::info() const { return m_info; }
 
+template_info& project_template::info() { return m_info; }
+
+bool project_template::is_packed() const { return m_pack != nullptr; }
+
+const template_pack* project_template::pack() const { return m_pack.get(); }
+
 std::optional<std::string> project_template::save_info() const {
+    if (m_info.is_upgraded_on_save()) {
+        print_info(std::format("template info of `{}` uses features V1 info files cannot hold, so it is saved as V2 - "
+                               "older versions of lppm cannot read it",
+                               m_base_directory));
+    }
+
+    // packs are written again as a whole (through a temporary file next to them, which changes the templates
+    // directory), the old contents stay mapped until the pack is released
+    if (is_packed()) {
+        auto registry_time = template_registry::directory_time();
+        auto result = m_pack->rewrite_with_info(m_base_directory, m_info.save_to_text());
+        template_registry::update(std::filesystem::path { m_base_directory }.stem(), registry_time);
+        return result;
+    }
+
     std::string info_path = std::filesystem::path { base_directory() } / template_info_file_name;
     return m_info.save_to_file(info_path);
 }
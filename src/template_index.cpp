@@ -0,0 +1,284 @@
+#include <lppm/template_index.h>
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <istream>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+#include <lppm/blob_store.h>
+#include <lppm/common.h>
+#include <lppm/ignore_matcher.h>
+#include <lppm/substitutor.h>
+#include <lppm/template.h>
+#include <lppm/utils.h>
+
+namespace lppm {
+
+// strings are stored with their length as a prefix (<length>:<bytes>), so they may contain any characters
+static void write_sized_string(std::ostream& stream, const std::string& value) {
+    stream << value.size() << ':' << value;
+}
+
+static bool read_sized_string(std::istream& stream, std::string& value) {
+    usz size = 0;
+    c8 separator = 0;
+    if (!(stream >> size >> separator) || separator != ':')
+        return false;
+    value.resize(size);
+    return static_cast<bool>(stream.read(value.data(), static_cast<std::streamsize>(size)));
+}
+
+static c8 content_kind_to_char(template_index::content_kind kind) {
+    switch (kind) {
+        case template_index::content_kind::binary:
+            return 'b';
+        case template_index::content_kind::verbatim:
+            return 'v';
+        case template_index::content_kind::rendered:
+            return 'r';
+        case template_index::content_kind::streamed:
+            return 's';
+    }
+    return '?';
+}
+
+static std::optional<template_index::content_kind> content_kind_from_char(c8 character) {
+    switch (character) {
+        case 'b':
+            return template_index::content_kind::binary;
+        case 'v':
+            return template_index::content_kind::verbatim;
+        case 'r':
+            return template_index::content_kind::rendered;
+        case 's':
+            return template_index::content_kind::streamed;
+    }
+    return {};
+}
+
+template_index template_index::load(const std::string& template_directory) {
+    // structure of the file is very simple, one line per file:
+    // LPPM INDEX V1
+    // <path> <kind> <size> <mtime> <variable count> <variables...> <marker count> (<offset> <length> <variable>)...
+    template_index result {};
+    std::ifstream file { std::filesystem::path { template_directory } / index_file_name, std::ios::binary };
+    if (!file)
+        return result;
+
+    // a missing, outdated or malformed index is not an error - it is just rebuilt
+    std::string header_line {};
+    if (!std::getline(file, header_line) || trim_string(header_line) != header_string_v1)
+        return result;
+
+    std::string relative_path {};
+    while (read_sized_string(file, relative_path)) {
+        file_entry entry {};
+        c8 kind_character = 0;
+        usz variable_count = 0;
+        if (!(file >> kind_character >> entry.size >> entry.modification_time >> variable_count))
+            return template_index {};
+        auto maybe_kind = content_kind_from_char(kind_character);
+        if (!maybe_kind.has_value())
+            return template_index {};
+        entry.kind = maybe_kind.value();
+
+        entry.variables.resize(variable_count);
+        for (auto& variable : entry.variables) {
+            if (!read_sized_string(file, variable))
+                return template_index {};
+        }
+
+        usz marker_count = 0;
+        if (!(file >> marker_count))
+            return template_index {};
+        entry.markers.resize(marker_count);
+        for (auto& marker : entry.markers) {
+            if (!(file >> marker.offset >> marker.length >> marker.variable_index))
+                return template_index {};
+        }
+
+        result.m_entries.insert_or_assign(relative_path, std::move(entry));
+    }
+    if (!file.eof())
+        return template_index {};
+
+    return result;
+}
+
+std::variant<std::string, template_index> template_index::build(const std::string& template_directory) {
+    template_index result {};
+    auto ignore = ignore_matcher::load(template_directory);
+    std::error_code code {};
+    for (std::filesystem::recursive_directory_iterator iterator { template_directory, code }, end {};
+         !code && iterator != end; iterator.increment(code)) {
+        auto& directory_entry = *iterator;
+        std::error_code type_code {};
+        bool is_directory = directory_entry.is_directory(type_code);
+        auto relative_path = std::filesystem::relative(directory_entry.path(), template_directory).generic_string();
+        if (ignore.is_ignored(relative_path, is_directory)) {
+            if (is_directory)
+                iterator.disable_recursion_pending();
+            continue;
+        }
+        if (std::error_code code; !directory_entry.is_regular_file(code) || code ||
+                                  is_template_metadata_file(directory_entry.path().filename()))
+            continue;
+
+        // scan every regular file in the template
+        std::error_code stamp_code {};
+        u64 size = directory_entry.file_size(stamp_code);
+        i64 modification_time = directory_entry.last_write_time(stamp_code).time_since_epoch().count();
+        if (stamp_code) {
+            return std::format("could not read attributes of file `{}`",
+                               static_cast<std::string>(directory_entry.path()));
+        }
+
+        auto entry = scan_file({ directory_entry.path() }, size, modification_time);
+        if (std::holds_alternative<std::string>(entry))
+            return std::get<std::string>(entry);
+        result.update(relative_path, std::move(std::get<file_entry>(entry)));
+    }
+    if (code)
+        return std::format("could not read template directory `{}` - {}", template_directory, code.message());
+
+    return result;
+}
+
+std::variant<std::string, template_index::file_entry>
+template_index::scan_file(const entry_location& location, u64 size, i64 modification_time,
+                          std::optional<file_contents>* contents, bool detect_binary) {
+    auto& path = location.path;
+    file_entry entry { size, modification_time };
+
+    // large files are scanned in chunks - binary ones are not scanned at all
+    if (size >= streamed_file_threshold) {
+        auto file_prefix = read_file_prefix(path, binary_detection_prefix_size);
+        if (!file_prefix.has_value())
+            return std::format("could not read contents of file `{}`", path);
+        if (detect_binary && looks_like_binary(file_prefix.value())) {
+            entry.kind = content_kind::binary;
+            return entry;
+        }
+
+        auto variables = stream_variable_names(path);
+        if (std::holds_alternative<std::string>(variables))
+            return std::get<std::string>(variables);
+        entry.variables = std::move(std::get<std::vector<std::string>>(variables));
+        entry.kind = entry.variables.empty() ? content_kind::verbatim : content_kind::streamed;
+        return entry;
+    }
+
+    // read file contents
+    auto maybe_contents = file_contents::read(location);
+    if (std::holds_alternative<std::string>(maybe_contents))
+        return std::get<std::string>(maybe_contents);
+    auto& read_contents = std::get<file_contents>(maybe_contents);
+    if (detect_binary && looks_like_binary(read_contents.view())) {
+        entry.kind = content_kind::binary;
+        return entry;
+    }
+
+    // record variables and positions of markers
+    auto compiled = compiled_text::compile(read_contents.view());
+    entry.variables = compiled.variables();
+    for (auto& segment : compiled.segments()) {
+        if (!segment.is_literal())
+            entry.markers.push_back(segment);
+    }
+    entry.kind = entry.variables.empty() ? content_kind::verbatim : content_kind::rendered;
+
+    // give the contents back to the caller, if it wants to use them
+    if (contents != nullptr && entry.kind == content_kind::rendered)
+        *contents = std::move(read_contents);
+    return entry;
+}
+
+bool template_index::is_template_metadata_file(const std::string& file_name) {
+    return file_name == project_template::template_info_file_name || file_name == index_file_name ||
+           file_name == ignore_matcher::ignore_file_name || file_name == blob_store::manifest_file_name;
+}
+
+std::optional<std::string> template_index::save(const std::string& template_directory) const {
+    // write to a temporary file first and rename it, so a partially written index is never read
+    std::string index_path = std::filesystem::path { template_directory } / index_file_name;
+    std::string temporary_path = unique_temporary_path(index_path);
+    std::error_code code {};
+    {
+        std::ofstream file { temporary_path, std::ios::binary };
+        if (!file)
+            return std::format("cannot open file `{}` for writing", temporary_path);
+
+        // files modified just now might be modified again within the timestamp granularity of the filesystem without
+        // changing their timestamp - such entries are written with a zeroed timestamp, so they are scanned again
+        auto racy_threshold = (std::filesystem::file_time_type::clock::now() - std::chrono::seconds { 2 })
+                                  .time_since_epoch()
+                                  .count();
+
+        file << header_string_v1 << '\n';
+        for (auto& [relative_path, entry] : m_entries) {
+            write_sized_string(file, relative_path);
+            file << ' ' << content_kind_to_char(entry.kind) << ' ' << entry.size << ' '
+                 << (entry.modification_time >= racy_threshold ? 0 : entry.modification_time)
+                 << ' ' << entry.variables.size();
+            for (auto& variable : entry.variables) {
+                file << ' ';
+                write_sized_string(file, variable);
+            }
+            file << ' ' << entry.markers.size();
+            for (auto& marker : entry.markers)
+                file << ' ' << marker.offset << ' ' << marker.length << ' ' << marker.variable_index;
+            file << '\n';
+        }
+
+        if (!file.flush()) {
+            std::filesystem::remove(temporary_path, code);
+            return std::format("cannot write file `{}`", temporary_path);
+        }
+    }
+
+    std::filesystem::rename(temporary_path, index_path, code);
+    if (code) {
+        auto message = code.message();
+        std::filesystem::remove(temporary_path, code);
+        return std::format("cannot replace file `{}` - {}", index_path, message);
+    }
+    return {};
+}
+
+const template_index::file_entry* template_index::find_fresh(const std::string& relative_path, u64 size,
+                                                             i64 modification_time) const {
+    auto iterator = m_entries.find(relative_path);
+    if (iterator == m_entries.end() || iterator->second.size != size ||
+        iterator->second.modification_time != modification_time)
+        return nullptr;
+    return &iterator->second;
+}
+
+void template_index::update(const std::string& relative_path, file_entry entry) {
+    m_entries.insert_or_assign(relative_path, std::move(entry));
+    m_modified = true;
+}
+
+void template_index::retain_only(const std::vector<std::string>& relative_paths) {
+    std::map<std::string, file_entry> retained_entries {};
+    for (auto& relative_path : relative_paths) {
+        if (auto node = m_entries.extract(relative_path); !node.empty())
+            retained_entries.insert(std::move(node));
+    }
+
+    // if anything was left behind, the entries belonged to removed files
+    if (!m_entries.empty())
+        m_modified = true;
+    m_entries = std::move(retained_entries);
+}
+
+bool template_index::is_modified() const { return m_modified; }
+
+} // namespace lppm
@@ -1,15 +1,25 @@
 #include <lppm/template_info.h>
 
+#include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <filesystem>
 #include <format>
 #include <fstream>
 #include <map>
 #include <optional>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include <lppm/command_graph.h>
 #include <lppm/common.h>
-#include <lppm/os.h>
+#include <lppm/file_contents.h>
+#include <lppm/glob.h>
+#include <lppm/profiler.h>
 #include <lppm/substitutor.h>
 #include <lppm/utils.h>
 
@@ -21,35 +31,85 @@ enum class parser_state {
 
 namespace lppm {
 
+std::string_view path_action_name(path_action action) {
+    switch (action) {
+        case path_action::render:
+            return "render";
+        case path_action::copy:
+            return "copy";
+        case path_action::skip:
+            return "skip";
+        case path_action::executable:
+            return "executable";
+    }
+    return "unknown";
+}
+
+std::optional<path_action> parse_path_action(std::string_view name) {
+    for (auto action : { path_action::render, path_action::copy, path_action::skip, path_action::executable }) {
+        if (path_action_name(action) == name)
+            return action;
+    }
+    return {};
+}
+
 template_info::template_info(std::vector<std::string> commands) : m_commands(std::move(commands)) {}
 
-std::variant<std::string, template_info> template_info::parse_from_file(const std::string& path) {
-    // structure of the file is very simple:
-    // LPPM TEMPLATE V1
-    // "<command1>";"<command2>";"<command3>"
+// takes the next line out of the contents, without the line terminator
+static std::string_view take_line(std::string_view& contents) {
+    auto line_end = contents.find('\n');
+    auto line = contents.substr(0, line_end);
+    contents.remove_prefix(line_end == std::string_view::npos ? contents.size() : line_end + 1);
+    if (line.ends_with('\r'))
+        line.remove_suffix(1);
+    return line;
+}
 
-    // open file
-    std::ifstream file { path };
-    if (!file)
+// splits a line into its first word and the (trimmed) rest of it
+static std::pair<std::string_view, std::string_view> split_key(std::string_view line) {
+    auto key_end = std::ranges::find_if(line, [](c8 c) { return std::isspace(static_cast<unsigned char>(c)); });
+    auto key_length = static_cast<usz>(key_end - line.begin());
+    return { line.substr(0, key_length), trim_string_view(line.substr(key_length)) };
+}
+
+std::variant<std::string, template_info> template_info::parse_from_file(const std::string& path) {
+    // the whole file is read at once (or mapped, if it is big) and parsed in a single pass over its lines
+    auto contents = file_contents::read(path);
+    if (std::holds_alternative<std::string>(contents))
         return std::format("cannot open file `{}` for reading", path);
+    return parse_from_text(std::get<file_contents>(contents).view(), path);
+}
 
-    // read header line and check it
-    std::string header_line {};
-    if (!std::getline(file, header_line))
+std::variant<std::string, template_info> template_info::parse_from_text(std::string_view contents,
+                                                                        const std::string& path) {
+    std::string_view remaining = contents;
+
+    // read header line and check it - V1 files are still read, and saved as V1 while they fit in it
+    if (remaining.empty())
         return std::format("cannot read header from file `{}` - file is empty", path);
-    trim_string_in_place(header_line);
-    if (header_line != header_string_v1)
-        return std::format("header contained in file `{}` is invalid for current lppm version", path);
+    auto header_line = trim_string_view(take_line(remaining));
+    if (header_line == header_string_v2)
+        return parse_v2(remaining, path);
+    if (header_line == header_string_v1)
+        return parse_v1(remaining, path);
+    return std::format("header contained in file `{}` is invalid for current lppm version", path);
+}
+
+std::variant<std::string, template_info> template_info::parse_v1(std::string_view contents, const std::string& path) {
+    // structure of the file is very simple:
+    // LPPM TEMPLATE V1
+    // "<command1>";"<command2>";"<command3>"
+    // after <command index>: <indices of commands it depends on...>
+    // timeout <command index>: <seconds>
+    // cpu-time <command index>: <seconds>
+    // memory <command index>: <bytes>
+    // timeout: <seconds of all commands together>
+    // (older versions of lppm ignore the settings lines, running the commands one after another without limits)
 
     // read next line containing commands to execute (if exists)
-    std::string commands_line {};
+    auto commands_line = trim_string_view(take_line(contents));
     std::vector<std::string> commands {};
-    std::getline(file, commands_line);
     if (!commands_line.empty()) {
-        trim_string_in_place(commands_line);
-        if (commands_line.empty())
-            goto end;
-
         // separate individual commands from the read line
         c8 last_character = 0;
         parser_state state { parser_state::outside };
@@ -125,8 +185,198 @@ std::variant<std::string, template_info> template_info::parse_from_file(const st
         }
     }
 
-end:
-    return template_info { std::move(commands) };
+    template_info result { std::move(commands) };
+    result.m_format_version = 1;
+
+    // read settings of the commands, if there are any
+    while (!contents.empty()) {
+        std::string settings_line { trim_string_view(take_line(contents)) };
+        if (settings_line.empty())
+            continue;
+        auto error = result.parse_settings_line(settings_line);
+        if (error.has_value())
+            return std::format("settings line `{}` in file `{}` is invalid - {}", settings_line, path, error.value());
+    }
+
+    return result;
+}
+
+std::variant<std::string, template_info> template_info::parse_v2(std::string_view contents, const std::string& path) {
+    // the file consists of sections, every line in them is a key followed by its value:
+    // LPPM TEMPLATE V2
+    // timeout <seconds of all commands together>
+    //
+    // [rules]
+    // <render|copy|skip|executable> <glob pattern>
+    //
+    // [defaults]
+    // <variable name> <value used when no other value is given>
+    //
+    // [command]
+    // run <command>              (or "run <<MARKER", followed by the lines of the command and a line with MARKER)
+    // after <indices of commands it depends on...>
+    // timeout <seconds>
+    // cpu-time <seconds>
+    // memory <bytes>
+    // directory <path relative to the project>
+    //
+    // empty lines and lines starting with # are ignored, durations and sizes may be given with unit suffixes
+    enum class section {
+        header,
+        rules,
+        defaults,
+        command,
+    };
+
+    template_info result { {} };
+    section current_section { section::header };
+    bool command_has_run_line = true;
+    usz line_number = 1;
+    auto line_error = [&](std::string_view message) {
+        return std::format("line {} in file `{}` is invalid - {}", line_number, path, message);
+    };
+
+    while (!contents.empty()) {
+        auto line = trim_string_view(take_line(contents));
+        line_number++;
+        if (line.empty() || line.starts_with('#'))
+            continue;
+
+        // section headers - every command section adds a new command
+        if (line.starts_with('[')) {
+            if (!command_has_run_line)
+                return line_error("the previous command does not have a `run` line");
+            if (line == "[rules]") {
+                current_section = section::rules;
+            } else if (line == "[defaults]") {
+                current_section = section::defaults;
+            } else if (line == "[command]") {
+                current_section = section::command;
+                result.add_command({});
+                command_has_run_line = false;
+            } else {
+                return line_error(std::format("unknown section `{}`", line));
+            }
+            continue;
+        }
+
+        auto [key, value] = split_key(line);
+        switch (current_section) {
+            case section::header: {
+                if (key != "timeout")
+                    return line_error(std::format("unknown setting `{}`", key));
+                auto seconds = parse_duration_seconds(value);
+                if (!seconds.has_value() || seconds.value() == 0)
+                    return line_error("expected a duration greater than zero");
+                result.m_timeout_seconds = seconds;
+                break;
+            }
+
+            case section::rules: {
+                auto action = parse_path_action(key);
+                if (!action.has_value())
+                    return line_error(std::format("unknown rule action `{}`", key));
+                if (auto error = result.add_path_rule({ action.value(), std::string { value } }); error.has_value())
+                    return line_error(error.value());
+                break;
+            }
+
+            case section::defaults: {
+                if (result.m_default_values.contains(std::string { key }))
+                    return line_error(std::format("variable `{}` already has a default value", key));
+                if (auto error = result.set_default_value(std::string { key }, std::string { value });
+                    error.has_value())
+                    return line_error(error.value());
+                break;
+            }
+
+            case section::command: {
+                usz index = result.m_commands.size() - 1;
+                std::optional<std::string> error {};
+                if (key == "run") {
+                    if (command_has_run_line)
+                        return line_error("the command already has a `run` line");
+                    command_has_run_line = true;
+                    if (!value.starts_with("<<")) {
+                        result.m_commands[index] = value;
+                        break;
+                    }
+
+                    // multi-line commands are taken verbatim up to the line with the marker
+                    auto marker = trim_string_view(value.substr(2));
+                    if (marker.empty())
+                        return line_error("expected a marker after <<");
+                    std::string command {};
+                    bool terminated = false;
+                    auto start_line_number = line_number;
+                    while (!contents.empty()) {
+                        auto command_line = take_line(contents);
+                        line_number++;
+                        if (command_line == marker) {
+                            terminated = true;
+                            break;
+                        }
+                        if (line_number > start_line_number + 1)
+                            command += '\n';
+                        command += command_line;
+                    }
+                    if (!terminated) {
+                        line_number = start_line_number;
+                        return line_error(std::format("the command is not terminated with `{}`", marker));
+                    }
+                    result.m_commands[index] = std::move(command);
+                } else if (key == "after") {
+                    std::vector<usz> dependencies {};
+                    for (auto remaining = value; !remaining.empty();) {
+                        auto [dependency_text, rest] = split_key(remaining);
+                        usz dependency = 0;
+                        auto [end, parse_error] = std::from_chars(
+                            dependency_text.data(), dependency_text.data() + dependency_text.size(), dependency);
+                        if (parse_error != std::errc {} || end != dependency_text.data() + dependency_text.size())
+                            return line_error("expected a list of command indices");
+                        dependencies.push_back(dependency);
+                        remaining = rest;
+                    }
+                    error = result.set_dependencies(index, std::move(dependencies));
+                } else if (key == "timeout" || key == "cpu-time") {
+                    auto seconds = parse_duration_seconds(value);
+                    if (!seconds.has_value())
+                        return line_error("expected a duration");
+                    error = result.set_limit(index, key == "timeout" ? command_limit::timeout : command_limit::cpu_time,
+                                             seconds);
+                } else if (key == "memory") {
+                    auto bytes = parse_byte_size(value);
+                    if (!bytes.has_value())
+                        return line_error("expected a size");
+                    error = result.set_limit(index, command_limit::memory, bytes);
+                } else if (key == "directory") {
+                    error = result.set_directory(index, std::string { value });
+                } else {
+                    return line_error(std::format("unknown command setting `{}`", key));
+                }
+                if (error.has_value())
+                    return line_error(error.value());
+                break;
+            }
+        }
+    }
+
+    if (!command_has_run_line)
+        return line_error("the last command does not have a `run` line");
+    return result;
+}
+
+// finds a marker for a multi-line command, which is not equal to any of its lines
+static std::string heredoc_marker_for(std::string_view command) {
+    std::string marker { "END" };
+    for (usz attempt = 1;; attempt++) {
+        bool collides = false;
+        for (auto remaining = command; !remaining.empty() && !collides;)
+            collides = take_line(remaining) == marker;
+        if (!collides)
+            return marker;
+        marker = std::format("END{}", attempt);
+    }
 }
 
 std::optional<std::string> template_info::save_to_file(const std::string& path) const {
@@ -135,40 +385,365 @@ std::optional<std::string> template_info::save_to_file(const std::string& path)
     if (!file)
         return std::format("cannot open file `{}` for writing", path);
 
+    write_to(file);
+    if (!file.flush())
+        return std::format("cannot write file `{}`", path);
+
+    // signal success
+    return {};
+}
+
+std::string template_info::save_to_text() const {
+    std::ostringstream stream {};
+    write_to(stream);
+    return stream.str();
+}
+
+bool template_info::is_upgraded_on_save() const { return m_format_version == 1 && !fits_v1(); }
+
+bool template_info::fits_v1() const {
+    // all commands are written on a single line and there is no V1 setting for the rest
+    if (!m_path_rules.empty() || !m_default_values.empty())
+        return false;
+    if (std::ranges::any_of(m_settings, [](auto& settings) { return settings.directory.has_value(); }))
+        return false;
+    return std::ranges::none_of(m_commands,
+                                [](auto& command) { return command.find_first_of("\r\n") != std::string::npos; });
+}
+
+void template_info::write_to(std::ostream& file) const {
+    if (m_format_version == 1 && fits_v1()) {
+        write_v1_to(file);
+        return;
+    }
+
+    // write a header and the settings of the whole template
+    file << header_string_v2 << '\n';
+    if (m_timeout_seconds.has_value())
+        file << "timeout " << m_timeout_seconds.value() << '\n';
+
+    if (!m_path_rules.empty()) {
+        file << "\n[rules]\n";
+        for (auto& rule : m_path_rules)
+            file << path_action_name(rule.action) << ' ' << rule.pattern << '\n';
+    }
+
+    if (!m_default_values.empty()) {
+        file << "\n[defaults]\n";
+        for (auto& [name, value] : m_default_values)
+            file << name << ' ' << value << '\n';
+    }
+
+    // write every command with the settings it has
+    for (usz index = 0; index < m_commands.size(); index++) {
+        auto& command = m_commands[index];
+        file << "\n[command]\n";
+
+        // commands which would not be read back the same from a single line are written as multi-line ones
+        bool single_line = command.find_first_of("\r\n") == std::string::npos && !command.starts_with("<<") &&
+                           trim_string_view(command) == command;
+        if (single_line) {
+            file << "run " << command << '\n';
+        } else {
+            auto marker = heredoc_marker_for(command);
+            file << "run <<" << marker << '\n' << command << '\n' << marker << '\n';
+        }
+
+        auto& settings = settings_of(index);
+        if (settings.dependencies.has_value()) {
+            file << "after";
+            for (auto dependency : settings.dependencies.value())
+                file << ' ' << dependency;
+            file << '\n';
+        }
+        if (settings.timeout_seconds.has_value())
+            file << "timeout " << settings.timeout_seconds.value() << '\n';
+        if (settings.limits.cpu_seconds.has_value())
+            file << "cpu-time " << settings.limits.cpu_seconds.value() << '\n';
+        if (settings.limits.memory_bytes.has_value())
+            file << "memory " << settings.limits.memory_bytes.value() << '\n';
+        if (settings.directory.has_value())
+            file << "directory " << settings.directory.value() << '\n';
+    }
+}
+
+void template_info::write_v1_to(std::ostream& file) const {
     // write a header and commands (if there are any)
     file << header_string_v1 << '\n';
     if (!m_commands.empty()) {
-        for (auto& command : m_commands)
-            file << '"' << command << "\";";
+        for (auto& command : m_commands) {
+            // quotes and backslashes are escaped, so they are read back as they are
+            file << '"';
+            for (c8 character : command) {
+                if (character == '"' || character == '\\')
+                    file << '\\';
+                file << character;
+            }
+            file << "\";";
+        }
         file << "\n";
     }
 
-    // signal success
-    return {};
+    // write settings of the commands that have any
+    for (usz index = 0; index < m_settings.size() && index < m_commands.size(); index++) {
+        auto& settings = m_settings[index];
+        if (settings.dependencies.has_value()) {
+            file << "after " << index << ":";
+            for (auto dependency : settings.dependencies.value())
+                file << ' ' << dependency;
+            file << '\n';
+        }
+        if (settings.timeout_seconds.has_value())
+            file << "timeout " << index << ": " << settings.timeout_seconds.value() << '\n';
+        if (settings.limits.cpu_seconds.has_value())
+            file << "cpu-time " << index << ": " << settings.limits.cpu_seconds.value() << '\n';
+        if (settings.limits.memory_bytes.has_value())
+            file << "memory " << index << ": " << settings.limits.memory_bytes.value() << '\n';
+    }
+    if (m_timeout_seconds.has_value())
+        file << "timeout: " << m_timeout_seconds.value() << '\n';
 }
 
 std::vector<std::string>& template_info::commands() const { return m_commands; }
 
-std::optional<std::string> template_info::run_commands_at(std::string directory_path,
-                                                          std::map<std::string, std::string>& mappings) const {
-    // save current working directory and switch to the new one
-    auto saved_wd = os::get_working_directory();
-    if (!os::set_working_directory(directory_path))
-        return std::format("could not change working directory to `{}`", directory_path);
-
-    // execute commands one-by-one
-    for (auto& command : m_commands) {
-        std::string substituted_command = do_the_substitutions(command, mappings);
-        int result = !os::run_command(substituted_command);
-        if (!result) {
-            os::set_working_directory(saved_wd);
-            return std::format("executed command `{}` returned non-zero ({}) exit code", substituted_command, result);
+void template_info::add_command(std::string command) { m_commands.push_back(std::move(command)); }
+
+void template_info::remove_command(usz index) {
+    if (index >= m_commands.size())
+        return;
+
+    // commands depending on the removed one take over its dependencies, so the ordering between the remaining
+    // commands stays the same - then all indices past the removed one are shifted
+    auto removed_dependencies = dependencies_of(index);
+    m_settings.resize(m_commands.size());
+    for (usz other = index + 1; other < m_settings.size(); other++) {
+        auto& dependencies = m_settings[other].dependencies;
+        if (!dependencies.has_value())
+            continue;
+        if (std::ranges::find(dependencies.value(), index) != dependencies->end())
+            dependencies->insert(dependencies->end(), removed_dependencies.begin(), removed_dependencies.end());
+        std::erase(dependencies.value(), index);
+        for (auto& dependency : dependencies.value())
+            dependency -= dependency > index ? 1 : 0;
+        std::ranges::sort(dependencies.value());
+        dependencies->erase(std::ranges::unique(dependencies.value()).begin(), dependencies->end());
+    }
+
+    m_commands.erase(m_commands.begin() + index);
+    m_settings.erase(m_settings.begin() + index);
+}
+
+const command_settings& template_info::settings_of(usz index) const {
+    static const command_settings default_settings {};
+    return index < m_settings.size() ? m_settings[index] : default_settings;
+}
+
+std::vector<usz> template_info::dependencies_of(usz index) const {
+    auto& declared = settings_of(index).dependencies;
+    if (declared.has_value())
+        return declared.value();
+    if (index == 0)
+        return {};
+    return { index - 1 };
+}
+
+std::optional<std::string> template_info::set_dependencies(usz index, std::optional<std::vector<usz>> dependencies) {
+    if (index >= m_commands.size())
+        return std::format("there is no command with index {}", index);
+
+    // commands may only depend on the commands before them, so the dependencies never form a cycle
+    if (dependencies.has_value()) {
+        for (auto dependency : dependencies.value()) {
+            if (dependency >= index)
+                return std::format("command {} cannot depend on command {}, which is not before it", index,
+                                   dependency);
         }
+        std::ranges::sort(dependencies.value());
+        dependencies->erase(std::ranges::unique(dependencies.value()).begin(), dependencies->end());
     }
 
-    // restore state and return
-    os::set_working_directory(saved_wd);
+    m_settings.resize(m_commands.size());
+    m_settings[index].dependencies = std::move(dependencies);
     return {};
 }
 
+std::optional<std::string> template_info::set_limit(usz index, command_limit limit, std::optional<u64> value) {
+    if (index >= m_commands.size())
+        return std::format("there is no command with index {}", index);
+    if (value.has_value() && value.value() == 0)
+        return "limits have to be greater than zero";
+
+    m_settings.resize(m_commands.size());
+    auto& settings = m_settings[index];
+    switch (limit) {
+        case command_limit::timeout:
+            settings.timeout_seconds = value;
+            break;
+        case command_limit::cpu_time:
+            settings.limits.cpu_seconds = value;
+            break;
+        case command_limit::memory:
+            settings.limits.memory_bytes = value;
+            break;
+    }
+    return {};
+}
+
+std::optional<std::string> template_info::set_directory(usz index, std::optional<std::string> directory) {
+    if (index >= m_commands.size())
+        return std::format("there is no command with index {}", index);
+    if (directory.has_value() && directory->empty())
+        return "the directory of a command cannot be empty";
+
+    m_settings.resize(m_commands.size());
+    m_settings[index].directory = std::move(directory);
+    return {};
+}
+
+std::optional<u64> template_info::timeout_seconds() const { return m_timeout_seconds; }
+
+void template_info::set_timeout_seconds(std::optional<u64> timeout_seconds) { m_timeout_seconds = timeout_seconds; }
+
+const std::vector<path_rule>& template_info::path_rules() const { return m_path_rules; }
+
+std::optional<std::string> template_info::add_path_rule(path_rule rule) {
+    std::string_view pattern { rule.pattern };
+    while (!pattern.empty() && pattern.front() == '/')
+        pattern.remove_prefix(1);
+    while (!pattern.empty() && pattern.back() == '/')
+        pattern.remove_suffix(1);
+    if (pattern.empty())
+        return "the pattern of a rule cannot be empty";
+
+    m_path_rules.push_back(std::move(rule));
+    return {};
+}
+
+void template_info::remove_path_rule(usz index) {
+    if (index < m_path_rules.size())
+        m_path_rules.erase(m_path_rules.begin() + index);
+}
+
+const std::map<std::string, std::string>& template_info::default_values() const { return m_default_values; }
+
+std::optional<std::string> template_info::set_default_value(std::string name, std::optional<std::string> value) {
+    // names are written as the first word of a line, so they cannot contain whitespace or markers
+    if (name.empty() || name.find_first_of(" \t\r\n") != std::string::npos || name.find("@@") != std::string::npos)
+        return std::format("`{}` is not a valid variable name", name);
+    if (!value.has_value()) {
+        if (m_default_values.erase(name) == 0)
+            return std::format("variable `{}` does not have a default value", name);
+        return {};
+    }
+    if (value->find_first_of("\r\n") != std::string::npos)
+        return "default values cannot span multiple lines";
+    m_default_values.insert_or_assign(std::move(name), trim_string(std::move(value.value())));
+    return {};
+}
+
+// checks whether the pattern matches the path itself or any of the directories containing it
+static bool rule_matches(std::string_view pattern, std::string_view path, bool is_directory) {
+    bool directories_only = pattern.ends_with('/');
+    if (directories_only)
+        pattern.remove_suffix(1);
+    bool anchored = pattern.find('/') != std::string_view::npos;
+    if (pattern.starts_with('/'))
+        pattern.remove_prefix(1);
+
+    // anchored patterns are matched against whole path prefixes, other ones against single components
+    for (usz component_start = 0;;) {
+        auto component_end = path.find('/', component_start);
+        bool whole_path = component_end == std::string_view::npos;
+        auto prefix = path.substr(0, component_end);
+        if ((!whole_path || is_directory || !directories_only) &&
+            match_glob(pattern, anchored ? prefix : prefix.substr(component_start)))
+            return true;
+        if (whole_path)
+            return false;
+        component_start = component_end + 1;
+    }
+}
+
+path_actions template_info::actions_for(std::string_view relative_path, bool is_directory) const {
+    path_actions result {};
+    for (auto& rule : m_path_rules) {
+        if (!rule_matches(rule.pattern, relative_path, is_directory))
+            continue;
+        if (rule.action == path_action::executable)
+            result.executable = true;
+        else
+            result.contents = rule.action;
+    }
+    return result;
+}
+
+std::optional<std::string> template_info::parse_settings_line(const std::string& line) {
+    // split the line into the setting name (with an optional command index) and its values
+    auto colon_position = line.find(':');
+    if (colon_position == std::string::npos)
+        return "expected a colon after the setting name";
+    std::istringstream name_stream { line.substr(0, colon_position) };
+    std::istringstream values_stream { line.substr(colon_position + 1) };
+    std::string name {};
+    std::string index_text {};
+    std::optional<usz> index {};
+    if (!(name_stream >> name))
+        return "expected a setting name";
+    if (name_stream >> index_text) {
+        usz parsed_index = 0;
+        auto [end, error] = std::from_chars(index_text.data(), index_text.data() + index_text.size(), parsed_index);
+        if (error != std::errc {} || end != index_text.data() + index_text.size() || name_stream >> index_text)
+            return "expected a command index after the setting name";
+        index = parsed_index;
+    }
+
+    std::vector<u64> values {};
+    for (u64 value = 0; values_stream >> value;)
+        values.push_back(value);
+    if (!values_stream.eof())
+        return "expected a list of numbers after the colon";
+
+    // the timeout of the whole template is the only setting without a command index
+    if (!index.has_value()) {
+        if (name != "timeout" || values.size() != 1)
+            return "expected a command index after the setting name";
+        m_timeout_seconds = values.front();
+        return {};
+    }
+
+    if (name == "after")
+        return set_dependencies(index.value(), std::vector<usz> { values.begin(), values.end() });
+    if (values.size() != 1)
+        return std::format("setting `{}` expects exactly one value", name);
+    if (name == "timeout")
+        return set_limit(index.value(), command_limit::timeout, values.front());
+    if (name == "cpu-time")
+        return set_limit(index.value(), command_limit::cpu_time, values.front());
+    if (name == "memory")
+        return set_limit(index.value(), command_limit::memory, values.front());
+    return std::format("unknown setting `{}`", name);
+}
+
+std::optional<std::string> template_info::run_commands_at(std::string directory_path, variable_scope& scope,
+                                                          usz max_parallel) const {
+    // substitute variables in all commands before any of them is started
+    variable_resolver resolver = [&scope](const std::string& variable_name) -> const std::string& {
+        return scope.resolve(variable_name);
+    };
+    std::vector<graph_command> graph {};
+    for (usz index = 0; index < m_commands.size(); index++) {
+        auto& settings = settings_of(index);
+        auto working_directory = directory_path;
+        if (settings.directory.has_value()) {
+            auto directory = do_the_substitutions(settings.directory.value(), resolver);
+            working_directory = (std::filesystem::path { directory_path } / directory).lexically_normal().string();
+        }
+        graph.push_back({ do_the_substitutions(m_commands[index], resolver), dependencies_of(index),
+                          std::move(working_directory), settings.timeout_seconds, settings.limits });
+    }
+
+    profile_span span { "commands", std::format("{} command(s)", graph.size()) };
+    return run_command_graph(graph, max_parallel, m_timeout_seconds);
+}
+
 } // namespace lppm
@@ -0,0 +1,320 @@
+#include <lppm/template_pack.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+#include <lppm/blob_store.h>
+#include <lppm/common.h>
+#include <lppm/file_contents.h>
+#include <lppm/ignore_matcher.h>
+#include <lppm/template.h>
+#include <lppm/template_index.h>
+#include <lppm/utils.h>
+
+namespace lppm {
+
+static constexpr std::string_view pack_magic = "LPPMPACK";
+
+static void append_number(std::string& output, u64 value, usz size) {
+    for (usz byte = 0; byte < size; byte++)
+        output += static_cast<c8>((value >> (byte * 8)) & 0xff);
+}
+
+// reads the numbers and strings of a pack one after another, remembering whether any of them was out of bounds
+class pack_reader {
+public:
+    explicit pack_reader(std::string_view data) : m_data(data) {}
+
+    u64 read_number(usz size) {
+        auto bytes = read_bytes(size);
+        u64 value = 0;
+        for (usz byte = 0; byte < bytes.size(); byte++)
+            value |= static_cast<u64>(static_cast<u8>(bytes[byte])) << (byte * 8);
+        return value;
+    }
+
+    std::string_view read_bytes(u64 size) {
+        if (m_failed || size > m_data.size() - m_position) {
+            m_failed = true;
+            return {};
+        }
+        auto bytes = m_data.substr(m_position, size);
+        m_position += size;
+        return bytes;
+    }
+
+    std::string_view remaining() const { return m_data.substr(m_position); }
+    bool failed() const { return m_failed; }
+
+private:
+    std::string_view m_data;
+    usz m_position { 0 };
+    bool m_failed { false };
+};
+
+// paths in a pack have to stay inside of the template when it is unpacked
+static bool is_safe_relative_path(const std::string& path) {
+    std::filesystem::path parsed { path };
+    if (path.empty() || parsed.is_absolute())
+        return false;
+    for (auto& component : parsed) {
+        if (component == "..")
+            return false;
+    }
+    return true;
+}
+
+std::variant<std::string, template_pack> template_pack::open(const std::string& pack_path) {
+    // the whole pack is mapped at once, entries point directly into the mapping
+    auto maybe_contents = file_contents::read(pack_path, true);
+    if (std::holds_alternative<std::string>(maybe_contents))
+        return std::get<std::string>(maybe_contents);
+    template_pack result { std::move(std::get<file_contents>(maybe_contents)) };
+
+    pack_reader reader { result.m_contents.view() };
+    if (reader.read_bytes(pack_magic.size()) != pack_magic)
+        return std::format("file `{}` is not a template pack", pack_path);
+    if (auto version = reader.read_number(4); version != format_version)
+        return std::format("template pack `{}` has unsupported format version {}", pack_path, version);
+    auto entry_count = reader.read_number(4);
+    auto info_size = reader.read_number(8);
+    auto index_size = reader.read_number(8);
+    result.m_info_text = reader.read_bytes(info_size);
+    pack_reader index_reader { reader.read_bytes(index_size) };
+    auto data = reader.remaining();
+    if (reader.failed())
+        return std::format("template pack `{}` is truncated", pack_path);
+
+    // read the records of all entries
+    result.m_entries.reserve(entry_count);
+    for (u64 index = 0; index < entry_count; index++) {
+        entry current {};
+        auto path_size = index_reader.read_number(4);
+        current.mode = static_cast<u32>(index_reader.read_number(4));
+        auto type = index_reader.read_number(1);
+        auto kind = index_reader.read_number(1);
+        auto variable_count = index_reader.read_number(4);
+        auto offset = index_reader.read_number(8);
+        auto size = index_reader.read_number(8);
+        current.path = index_reader.read_bytes(path_size);
+        for (u64 variable = 0; variable < variable_count && !index_reader.failed(); variable++)
+            current.variables.emplace_back(index_reader.read_bytes(index_reader.read_number(4)));
+
+        if (index_reader.failed() || type > static_cast<u8>(entry_type::file) ||
+            kind > static_cast<u8>(template_index::content_kind::streamed) || offset > data.size() ||
+            size > data.size() - offset)
+            return std::format("index of template pack `{}` is malformed", pack_path);
+        if (!is_safe_relative_path(current.path))
+            return std::format("template pack `{}` contains invalid path `{}`", pack_path, current.path);
+        current.type = static_cast<entry_type>(type);
+        current.kind = static_cast<template_index::content_kind>(kind);
+        current.contents = data.substr(offset, size);
+        result.m_entries.push_back(std::move(current));
+    }
+
+    return result;
+}
+
+std::optional<std::string> template_pack::pack_directory(const std::string& template_directory,
+                                                         const std::string& pack_path) {
+    auto info_text =
+        read_all_text(std::filesystem::path { template_directory } / project_template::template_info_file_name);
+    if (!info_text.has_value())
+        return std::format("cannot read template info of template at `{}`", template_directory);
+
+    // walk the template like instantiation does, taking the contents description from the index when it is fresh
+    auto index = template_index::load(template_directory);
+    auto ignore = ignore_matcher::load(template_directory);
+    std::vector<pending_entry> entries {};
+    std::error_code code {};
+    for (std::filesystem::recursive_directory_iterator iterator { template_directory, code }, end {};
+         !code && iterator != end; iterator.increment(code)) {
+        auto& directory_entry = *iterator;
+        auto relative_path = directory_entry.path().lexically_relative(template_directory).generic_string();
+
+        std::error_code status_code {};
+        auto status = directory_entry.status(status_code);
+        bool is_directory = std::filesystem::is_directory(status);
+        if (ignore.is_ignored(relative_path, is_directory)) {
+            if (is_directory)
+                iterator.disable_recursion_pending();
+            continue;
+        }
+        if (relative_path == project_template::template_info_file_name ||
+            relative_path == template_index::index_file_name || relative_path == blob_store::manifest_file_name)
+            continue;
+        if (status_code || (!is_directory && !std::filesystem::is_regular_file(status)))
+            continue;
+
+        pending_entry pending { { relative_path, static_cast<u32>(status.permissions()) & 07777 } };
+        if (is_directory) {
+            pending.description.type = entry_type::directory;
+            entries.push_back(std::move(pending));
+            continue;
+        }
+
+        std::error_code stamp_code {};
+        pending.size = directory_entry.file_size(stamp_code);
+        i64 modification_time = directory_entry.last_write_time(stamp_code).time_since_epoch().count();
+        if (stamp_code)
+            return std::format("could not read attributes of file `{}`",
+                               static_cast<std::string>(directory_entry.path()));
+        pending.source_path = directory_entry.path();
+
+        if (auto index_entry = index.find_fresh(relative_path, pending.size, modification_time)) {
+            pending.description.kind = index_entry->kind;
+            pending.description.variables = index_entry->variables;
+        } else {
+            auto scanned = template_index::scan_file({ pending.source_path }, pending.size, modification_time);
+            if (std::holds_alternative<std::string>(scanned))
+                return std::get<std::string>(scanned);
+            pending.description.kind = std::get<template_index::file_entry>(scanned).kind;
+            pending.description.variables = std::move(std::get<template_index::file_entry>(scanned).variables);
+        }
+        entries.push_back(std::move(pending));
+    }
+    if (code)
+        return std::format("could not read template directory `{}` - {}", template_directory, code.message());
+
+    return write(pack_path, info_text.value(), entries);
+}
+
+std::string_view template_pack::info_text() const { return m_info_text; }
+
+const std::vector<template_pack::entry>& template_pack::entries() const { return m_entries; }
+
+std::optional<std::string> template_pack::rewrite_with_info(const std::string& pack_path,
+                                                            std::string_view info_text) const {
+    std::vector<pending_entry> entries {};
+    entries.reserve(m_entries.size());
+    for (auto& current : m_entries)
+        entries.push_back({ current, current.contents.size() });
+    return write(pack_path, info_text, entries);
+}
+
+std::optional<std::string> template_pack::unpack_to(const std::string& template_directory) const {
+    std::error_code code {};
+    std::filesystem::create_directories(template_directory, code);
+    if (code)
+        return std::format("cannot create directory `{}` - {}", template_directory, code.message());
+
+    auto write_contents = [](const std::string& path, std::string_view contents) -> std::optional<std::string> {
+        std::ofstream file { path, std::ios::binary };
+        if (!file || !file.write(contents.data(), static_cast<std::streamsize>(contents.size())) || !file.flush())
+            return std::format("cannot write file `{}`", path);
+        return {};
+    };
+    auto info_path = std::filesystem::path { template_directory } / project_template::template_info_file_name;
+    if (auto result = write_contents(info_path, m_info_text); result.has_value())
+        return result;
+
+    // modes of directories are restored at the end, so read-only directories can still be filled
+    std::vector<const entry*> directories {};
+    for (auto& current : m_entries) {
+        std::string path = std::filesystem::path { template_directory } / current.path;
+        if (current.type == entry_type::directory) {
+            std::filesystem::create_directories(path, code);
+            if (code)
+                return std::format("cannot create directory `{}` - {}", path, code.message());
+            directories.push_back(&current);
+            continue;
+        }
+
+        if (auto result = write_contents(path, current.contents); result.has_value())
+            return result;
+        std::filesystem::permissions(path, static_cast<std::filesystem::perms>(current.mode), code);
+        if (code)
+            return std::format("cannot set mode of file `{}` - {}", path, code.message());
+    }
+    for (auto iterator = directories.rbegin(); iterator != directories.rend(); iterator++) {
+        std::string path = std::filesystem::path { template_directory } / (*iterator)->path;
+        std::filesystem::permissions(path, static_cast<std::filesystem::perms>((*iterator)->mode), code);
+        if (code)
+            return std::format("cannot set mode of directory `{}` - {}", path, code.message());
+    }
+
+    return {};
+}
+
+std::optional<std::string> template_pack::write(const std::string& pack_path, std::string_view info_text,
+                                                const std::vector<pending_entry>& entries) {
+    // build the index first, offsets of the contents are known from the sizes alone
+    std::string index {};
+    u64 data_size = 0;
+    for (auto& pending : entries) {
+        auto& description = pending.description;
+        u64 size = description.type == entry_type::file ? pending.size : 0;
+        append_number(index, description.path.size(), 4);
+        append_number(index, description.mode, 4);
+        append_number(index, static_cast<u8>(description.type), 1);
+        append_number(index, static_cast<u8>(description.kind), 1);
+        append_number(index, description.variables.size(), 4);
+        append_number(index, data_size, 8);
+        append_number(index, size, 8);
+        index += description.path;
+        for (auto& variable : description.variables) {
+            append_number(index, variable.size(), 4);
+            index += variable;
+        }
+        data_size += size;
+    }
+
+    std::string header { pack_magic };
+    append_number(header, format_version, 4);
+    append_number(header, entries.size(), 4);
+    append_number(header, info_text.size(), 8);
+    append_number(header, index.size(), 8);
+
+    // write to a temporary file first and rename it, so a partially written pack is never read
+    std::string temporary_path = unique_temporary_path(pack_path);
+    auto write_temporary = [&]() -> std::optional<std::string> {
+        std::ofstream file { temporary_path, std::ios::binary };
+        if (!file)
+            return std::format("cannot open file `{}` for writing", temporary_path);
+        file << header << info_text << index;
+
+        for (auto& pending : entries) {
+            if (pending.description.type != entry_type::file)
+                continue;
+            if (pending.source_path.empty()) {
+                file.write(pending.description.contents.data(), pending.description.contents.size());
+                continue;
+            }
+
+            auto contents = file_contents::read(pending.source_path);
+            if (std::holds_alternative<std::string>(contents))
+                return std::get<std::string>(contents);
+            auto view = std::get<file_contents>(contents).view();
+            if (view.size() != pending.size)
+                return std::format("file `{}` changed while it was being packed", pending.source_path);
+            file.write(view.data(), view.size());
+        }
+
+        if (!file.flush())
+            return std::format("cannot write file `{}`", temporary_path);
+        return {};
+    };
+
+    std::error_code code {};
+    if (auto result = write_temporary(); result.has_value()) {
+        std::filesystem::remove(temporary_path, code);
+        return result;
+    }
+    std::filesystem::rename(temporary_path, pack_path, code);
+    if (code) {
+        auto message = code.message();
+        std::filesystem::remove(temporary_path, code);
+        return std::format("cannot replace file `{}` - {}", pack_path, message);
+    }
+    return {};
+}
+
+} // namespace lppm
@@ -0,0 +1,198 @@
+#include <lppm/template_registry.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <lppm/cli.h>
+#include <lppm/common.h>
+#include <lppm/os.h>
+#include <lppm/template.h>
+#include <lppm/template_pack.h>
+#include <lppm/utils.h>
+
+#if defined(__linux__)
+#include <sys/stat.h>
+#endif
+
+namespace lppm {
+
+// directories are templates only if they contain a template info file - its presence is checked relative to the
+// templates directory if its descriptor is given, the file itself is not read
+static bool has_template_info(int templates_fd, const std::filesystem::path& directory_path) {
+    auto info_path = directory_path / project_template::template_info_file_name;
+#if defined(__linux__)
+    if (templates_fd != entry_location::no_descriptor) {
+        struct stat info_stat {};
+        auto relative_path = (directory_path.filename() / project_template::template_info_file_name).string();
+        return fstatat(templates_fd, relative_path.c_str(), &info_stat, 0) == 0 && !S_ISDIR(info_stat.st_mode);
+    }
+#endif
+    std::error_code code {};
+    return std::filesystem::exists(info_path, code) && !std::filesystem::is_directory(info_path, code);
+}
+
+std::vector<template_registry::entry> template_registry::list() {
+    auto current_time = directory_time();
+    if (!current_time.has_value())
+        return {};
+
+    if (auto entries = load(current_time.value()); entries.has_value())
+        return std::move(entries.value());
+    auto entries = scan();
+    save(entries, current_time.value());
+    return entries;
+}
+
+std::string template_registry::path_of(const entry& template_entry) {
+    std::string path = std::filesystem::absolute(std::filesystem::path { templates_directory_path() } /
+                                                 template_entry.name);
+    return template_entry.is_packed ? path + template_pack::file_extension : path;
+}
+
+std::optional<i64> template_registry::directory_time() {
+    std::error_code code {};
+    auto time = std::filesystem::last_write_time(templates_directory_path(), code);
+    if (code)
+        return {};
+    return time.time_since_epoch().count();
+}
+
+void template_registry::update(const std::string& name, std::optional<i64> previous_time) {
+    auto current_time = directory_time();
+    if (!current_time.has_value())
+        return;
+
+    // the list written before the change is still valid apart from the changed template, so only its entry is replaced
+    auto maybe_entries = previous_time.has_value() ? load(previous_time.value()) : std::nullopt;
+    if (!maybe_entries.has_value()) {
+        save(scan(), current_time.value());
+        return;
+    }
+    auto& entries = maybe_entries.value();
+    auto iterator = std::ranges::lower_bound(entries, name, {}, &entry::name);
+    bool is_listed = iterator != entries.end() && iterator->name == name;
+    auto found = find_template(name);
+    if (found.has_value() && is_listed)
+        *iterator = std::move(found.value());
+    else if (found.has_value())
+        entries.insert(iterator, std::move(found.value()));
+    else if (is_listed)
+        entries.erase(iterator);
+    save(entries, current_time.value());
+}
+
+std::optional<std::vector<template_registry::entry>> template_registry::load(i64 expected_time) {
+    // structure of the file:
+    // LPPM REGISTRY V1
+    // <modification time of the templates directory>
+    // <d|p> <name>                                     (for every template, sorted by name)
+    std::ifstream file { registry_file_path(), std::ios::binary };
+    if (!file)
+        return {};
+
+    // a missing, outdated or malformed registry is not an error - it is just built again
+    std::string line {};
+    if (!std::getline(file, line) || trim_string(line) != header_string_v1)
+        return {};
+    if (!std::getline(file, line) || line != std::to_string(expected_time))
+        return {};
+
+    std::vector<entry> result {};
+    while (std::getline(file, line)) {
+        if (line.size() < 3 || (line[0] != 'd' && line[0] != 'p') || line[1] != ' ')
+            return {};
+        result.push_back({ line.substr(2), line[0] == 'p' });
+    }
+    if (!file.eof())
+        return {};
+    return result;
+}
+
+std::vector<template_registry::entry> template_registry::scan() {
+    // only names of the entries (and presence of info files in directories) are looked at, the templates themselves
+    // are loaded once they are used
+    std::vector<entry> result {};
+    auto templates_fd = os::open_directory({ templates_directory_path() });
+    std::error_code code {};
+    for (std::filesystem::directory_iterator iterator { templates_directory_path(), code }, end {};
+         !code && iterator != end; iterator.increment(code)) {
+        auto path = iterator->path();
+        std::error_code type_code {};
+        if (iterator->is_regular_file(type_code) && path.extension() == template_pack::file_extension) {
+            result.push_back({ path.stem(), true });
+        } else if (iterator->is_directory(type_code) && has_template_info(templates_fd, path)) {
+            result.push_back({ path.filename(), false });
+        }
+    }
+    os::close_directory(templates_fd);
+
+    // names are stored one per line, a directory and a pack with the same name are listed once (as the directory,
+    // which is the one used by template_from_directory)
+    std::erase_if(result, [](auto& current) { return current.name.find('\n') != std::string::npos; });
+    std::ranges::sort(result, [](auto& left, auto& right) {
+        return left.name != right.name ? left.name < right.name : !left.is_packed && right.is_packed;
+    });
+    auto duplicates = std::ranges::unique(result, {}, &entry::name);
+    result.erase(duplicates.begin(), duplicates.end());
+    return result;
+}
+
+void template_registry::save(const std::vector<entry>& entries, i64 directory_time) {
+    // directories changed just now might be changed again within the timestamp granularity of the filesystem without
+    // changing their timestamp - such list is written with a zeroed time, so it is built again next time
+    auto racy_threshold =
+        (std::filesystem::file_time_type::clock::now() - std::chrono::seconds { 2 }).time_since_epoch().count();
+    std::string contents =
+        std::format("{}\n{}\n", header_string_v1, directory_time >= racy_threshold ? 0 : directory_time);
+    for (auto& current : entries)
+        contents += std::format("{} {}\n", current.is_packed ? 'p' : 'd', current.name);
+
+    // write to a temporary file first and rename it, so a partially written list is never read - the list is only a
+    // cache, so failing to write it is not fatal
+    auto registry_path = registry_file_path();
+    auto temporary_path = unique_temporary_path(registry_path);
+    {
+        std::ofstream file { temporary_path, std::ios::binary };
+        if (!file || !file.write(contents.data(), static_cast<std::streamsize>(contents.size())) || !file.flush()) {
+            std::error_code code {};
+            std::filesystem::remove(temporary_path, code);
+            print_warning(std::format("could not write template registry `{}`", temporary_path));
+            return;
+        }
+    }
+    std::error_code code {};
+    std::filesystem::rename(temporary_path, registry_path, code);
+    if (code) {
+        auto message = code.message();
+        std::filesystem::remove(temporary_path, code);
+        print_warning(std::format("could not replace template registry `{}` - {}", registry_path, message));
+    }
+}
+
+std::optional<template_registry::entry> template_registry::find_template(const std::string& name) {
+    std::filesystem::path path = std::filesystem::path { templates_directory_path() } / name;
+    if (std::error_code code;
+        std::filesystem::is_directory(path, code) && !code && has_template_info(entry_location::no_descriptor, path))
+        return entry { name, false };
+    if (std::error_code code; std::filesystem::is_regular_file(path.string() + template_pack::file_extension, code) &&
+                              !code)
+        return entry { name, true };
+    return {};
+}
+
+std::string template_registry::templates_directory_path() {
+    return std::filesystem::path { os::get_lppm_config_directory() } / project_template::templates_directory_name;
+}
+
+std::string template_registry::registry_file_path() {
+    return std::filesystem::path { os::get_lppm_config_directory() } / registry_file_name;
+}
+
+} // namespace lppm
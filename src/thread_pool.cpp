@@ -0,0 +1,116 @@
+#include <lppm/thread_pool.h>
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include <lppm/common.h>
+
+namespace lppm {
+
+thread_pool::thread_pool(usz worker_count) {
+    worker_count = std::max<usz>(worker_count, 1);
+    for (usz index = 0; index < worker_count; index++)
+        m_queues.push_back(std::make_unique<task_queue>());
+    for (usz index = 0; index < worker_count; index++)
+        m_workers.emplace_back([this, index] { run_worker(index); });
+}
+
+thread_pool::~thread_pool() {
+    wait();
+    {
+        std::lock_guard lock { m_state_mutex };
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void thread_pool::submit(task new_task) {
+    // tasks submitted by workers go to their own queue (so related work stays on one thread until stolen), other
+    // tasks are distributed round-robin
+    usz queue_index = s_current_pool == this ? s_current_worker_index
+                                             : m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    // counters are incremented first, so they never drop below zero when a task is taken right after being pushed
+    {
+        std::lock_guard lock { m_state_mutex };
+        m_queued_count++;
+        m_unfinished_count++;
+    }
+    {
+        auto& queue = *m_queues[queue_index];
+        std::lock_guard lock { queue.mutex };
+        queue.tasks.push_back(std::move(new_task));
+    }
+    m_work_available.notify_one();
+}
+
+void thread_pool::wait() {
+    std::unique_lock lock { m_state_mutex };
+    m_work_finished.wait(lock, [this] { return m_unfinished_count == 0; });
+}
+
+usz thread_pool::worker_count() const { return m_workers.size(); }
+
+std::optional<usz> thread_pool::current_worker_index() const {
+    if (s_current_pool != this)
+        return {};
+    return s_current_worker_index;
+}
+
+bool thread_pool::try_take_task(usz worker_index, task& result) {
+    // take the most recently pushed task from own queue first...
+    {
+        auto& queue = *m_queues[worker_index];
+        std::lock_guard lock { queue.mutex };
+        if (!queue.tasks.empty()) {
+            result = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_queued_count--;
+            return true;
+        }
+    }
+
+    // ...then try to steal the oldest task from other queues
+    for (usz offset = 1; offset < m_queues.size(); offset++) {
+        auto& queue = *m_queues[(worker_index + offset) % m_queues.size()];
+        std::lock_guard lock { queue.mutex };
+        if (!queue.tasks.empty()) {
+            result = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_queued_count--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void thread_pool::run_worker(usz worker_index) {
+    s_current_pool = this;
+    s_current_worker_index = worker_index;
+
+    while (true) {
+        task current_task {};
+        if (!try_take_task(worker_index, current_task)) {
+            // sleep until there is some work queued (anywhere) or the pool is being destroyed
+            std::unique_lock lock { m_state_mutex };
+            m_work_available.wait(lock, [this] { return m_queued_count > 0 || m_stopping; });
+            if (m_stopping && m_queued_count == 0)
+                return;
+            continue;
+        }
+
+        current_task();
+
+        // signal waiters if this was the last unfinished task
+        std::lock_guard lock { m_state_mutex };
+        if (--m_unfinished_count == 0)
+            m_work_finished.notify_all();
+    }
+}
+
+} // namespace lppm
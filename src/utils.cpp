@@ -1,12 +1,19 @@
-#include <iterator>
 #include <lppm/utils.h>
 
 #include <algorithm>
+#include <charconv>
+#include <format>
 #include <fstream>
-#include <streambuf>
+#include <ios>
+#include <mutex>
+#include <random>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
 
 #include <lppm/common.h>
+#include <lppm/file_contents.h>
 
 namespace lppm {
 
@@ -38,13 +45,74 @@ void trim_string_right_in_place(std::string& input) {
     input.erase(std::find_if(input.rbegin(), input.rend(), [](c8 c) { return !std::isspace(c); }).base(), input.end());
 }
 
+std::string_view trim_string_view(std::string_view input) {
+    while (!input.empty() && std::isspace(static_cast<unsigned char>(input.front())))
+        input.remove_prefix(1);
+    while (!input.empty() && std::isspace(static_cast<unsigned char>(input.back())))
+        input.remove_suffix(1);
+    return input;
+}
+
 std::optional<std::string> read_all_text(const std::string& path) {
-    std::ifstream file { path };
+    auto contents = file_contents::read(path);
+    if (std::holds_alternative<std::string>(contents))
+        return {};
+
+    // copy the text out of the (possibly mapped) file contents at once
+    return std::string { std::get<file_contents>(contents).view() };
+}
+
+std::optional<std::string> read_file_prefix(const std::string& path, std::size_t size) {
+    std::ifstream file { path, std::ios::binary };
     if (!file)
         return {};
 
-    // read text and return it
-    return std::string { std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> {} };
+    // read at most size bytes
+    std::string result(size, '\0');
+    file.read(result.data(), static_cast<std::streamsize>(size));
+    if (!file && !file.eof())
+        return {};
+    result.resize(static_cast<std::size_t>(file.gcount()));
+    return result;
+}
+
+bool looks_like_binary(std::string_view contents) {
+    // use the same heuristic as git does - a NUL byte in the first few kilobytes means the file is binary
+    return contents.substr(0, binary_detection_prefix_size).find('\0') != std::string_view::npos;
+}
+
+// parses a number followed by an optional unit suffix, which is multiplied by the unit factor
+static std::optional<u64> parse_number_with_unit(std::string_view text, std::string_view units, const u64* factors) {
+    u64 value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc {} || end == text.data())
+        return {};
+
+    std::string_view suffix { end, static_cast<usz>(text.data() + text.size() - end) };
+    if (suffix.empty())
+        return value;
+    auto unit_index = suffix.size() == 1 ? units.find(suffix.front()) : std::string_view::npos;
+    if (unit_index == std::string_view::npos || value > static_cast<u64>(-1) / factors[unit_index])
+        return {};
+    return value * factors[unit_index];
+}
+
+std::optional<u64> parse_duration_seconds(std::string_view text) {
+    static constexpr u64 factors[] = { 1, 60, 60 * 60, 24 * 60 * 60 };
+    return parse_number_with_unit(text, "smhd", factors);
+}
+
+std::optional<u64> parse_byte_size(std::string_view text) {
+    static constexpr u64 factors[] = { 1ull << 10, 1ull << 20, 1ull << 30, 1ull << 40 };
+    return parse_number_with_unit(text, "KMGT", factors);
+}
+
+std::string unique_temporary_path(const std::string& path) {
+    // the generator is seeded once per process - the random seed keeps names of different processes apart
+    static std::mutex generator_mutex {};
+    static std::mt19937 generator { std::random_device {}() };
+    std::lock_guard lock { generator_mutex };
+    return std::format("{}.{:08x}.tmp", path, generator());
 }
 
 } // namespace lppm
@@ -0,0 +1,96 @@
+#include <lppm/variable_scope.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <lppm/common.h>
+#include <lppm/globals.h>
+#include <lppm/options.h>
+#include <lppm/substitutor.h>
+
+#include <unistd.h>
+
+namespace lppm {
+
+variable_scope::variable_scope(const std::map<std::string, std::string>* template_defaults) {
+    m_layers[static_cast<usz>(layer::overrides)] = &options::the().variables();
+    m_layers[static_cast<usz>(layer::template_defaults)] = template_defaults;
+    m_layers[static_cast<usz>(layer::globals)] = &globals::the().values();
+    m_layers[static_cast<usz>(layer::environment)] = &environment_values();
+}
+
+void variable_scope::set_layer(layer which, const std::map<std::string, std::string>* values) {
+    // the project layer always refers to the values owned by the scope
+    if (which != layer::project)
+        m_layers[static_cast<usz>(which)] = values;
+}
+
+const std::map<std::string, std::string>* variable_scope::layer_values(usz index) const {
+    return index == static_cast<usz>(layer::project) ? &m_project_values : m_layers[index];
+}
+
+std::map<std::string, std::string>& variable_scope::project_values() { return m_project_values; }
+
+const std::string* variable_scope::find(const std::string& name) const {
+    for (usz index = 0; index < layer_count; index++) {
+        auto* values = layer_values(index);
+        if (values == nullptr)
+            continue;
+        if (auto iterator = values->find(name); iterator != values->end())
+            return &iterator->second;
+    }
+    return nullptr;
+}
+
+std::optional<variable_scope::layer> variable_scope::layer_of(const std::string& name) const {
+    for (usz index = 0; index < layer_count; index++) {
+        if (auto* values = layer_values(index); values != nullptr && values->contains(name))
+            return static_cast<layer>(index);
+    }
+    return {};
+}
+
+const std::string& variable_scope::resolve(const std::string& name) {
+    if (auto* value = find(name); value != nullptr)
+        return *value;
+    return resolve_variable(name, m_project_values);
+}
+
+std::string_view variable_scope::layer_name(layer which) {
+    switch (which) {
+        case layer::overrides:
+            return "command line";
+        case layer::project:
+            return "project";
+        case layer::template_defaults:
+            return "template defaults";
+        case layer::globals:
+            return "globals";
+        case layer::environment:
+            return "environment";
+    }
+    return "unknown";
+}
+
+const std::map<std::string, std::string>& variable_scope::environment_values() {
+    // the environment is read only once, the first time any scope is created
+    static const std::map<std::string, std::string> result = [] {
+        std::map<std::string, std::string> values {};
+        for (char** variable = environ; variable != nullptr && *variable != nullptr; variable++) {
+            std::string_view entry { *variable };
+            auto equals_position = entry.find('=');
+            if (!entry.starts_with(environment_prefix) || equals_position == std::string_view::npos ||
+                equals_position == environment_prefix.size())
+                continue;
+            values.insert_or_assign(std::string { entry.substr(environment_prefix.size(),
+                                                               equals_position - environment_prefix.size()) },
+                                    std::string { entry.substr(equals_position + 1) });
+        }
+        return values;
+    }();
+    return result;
+}
+
+} // namespace lppm